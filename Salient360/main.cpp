@@ -37,6 +37,9 @@
 #include <BMSSaliency.h>
 #include <GBVSSaliency.h>
 #include <Saliency360.h>
+#include <FrameCache.h>
+#include <ThreadPool.h>
+#include <FFTPlans.h>
 
 #define SUBMISSION 1
 
@@ -72,6 +75,24 @@ int main(int argc, char **argv) {
 		("threads,t", po::value< int>(),"Number of threads [default]: 8")
 		("general-model", po::value< int >(), "Select the type of result from the model: [1] Head saliency maps. [2] Head/Eye saliency maps (GBVS360). [3] Scan path. [4] Head/Eye saliency maps (Projected saliency). [5] Head/Eye saliency maps (Average between model [2] and [4]). [6] BMS360 mode. default: 2")
 		("equatorial-prior", "Add an equatorial prior to the saliency map")
+		("sparse-graph", po::value< double >(), "Use a sparse graph in the GBVS activation: edges with a weight below the provided cutoff are dropped (e.g. 0.001). [default]: dense graph")
+		("graph-engine", po::value< int >(), "Engine of the GBVS activation: 1) the markov matrix is built, 2) matrix-free markov chain. [default]: 1")
+		("activation-batch", po::value< int >(), "Number of feature maps solved together by a GBVS activation job (matrix-free engine only). [default]: 1")
+		("single-precision", "The markov chains of the GBVS activation are computed in single precision (matrix-free engine only).")
+		("eigen-solver", po::value< int >(), "Eigenvector solver of the GBVS activation: 1) power iterations, 2) power iterations with Aitken extrapolation (matrix-free engine only). [default]: 1")
+		("warm-start", "The eigenvector iterations of the GBVS activation start from the map instead of the uniform vector (matrix-free engine only).")
+		("report-iterations", "Print the number of iterations of the GBVS activation and normalization of each map.")
+		("graph-cache", po::value< std::string >(), "Directory where the graphs of the GBVS activation are stored. They are loaded from it instead of being built at each run, and added to it when missing.")
+#ifdef WITH_FFTW
+		("csf", "Apply the contrast sensitivity function to the luminance in GBVS.")
+		("fft-wisdom", po::value< std::string >(), "File where the FFTW plans of the contrast sensitivity function are saved and loaded from. Empty to disable it. [default]: wisdom3.txt")
+#endif
+		("back-projection", po::value< int >(), "Back-projection of the feature maps to the equirectangular domain: 1) each map on its own, 2) the maps with the same resolution are packed and back-projected together. [default]: 2")
+		("tiling", po::value< int >(), "Centres of the projected frames: 1) regular azimuth x elevation grid, 2) uniform on the sphere (Fibonacci spiral), with the least frames covering it, 3) the 6 faces of a cube map (requires square frames, ignores the aperture). [default]: 1")
+		("tile-overlap", po::value< double >(), "Overlap ratio between the neighbouring frames of the spiral tiling. [default]: 0.2")
+		("cube-guard-band", po::value< double >(), "Guard band added around the faces of the cube map, as a ratio of the half face. The faces are blended over it. [default]: 0.1")
+		("sphere-graph", po::value< int >(), "Graph of the activation: 0) the grid of the equirectangular feature maps, k) the near-uniform icosahedral grid of the sphere with k subdivisions (10*4^k+2 nodes, e.g. 3 for 642 nodes), k <= 7, and k <= 5 without --sparse-graph. Not available with the scanpaths. [default]: 0")
+		("feature-front-end", po::value< int >(), "Extraction of the features of GBVS360: 1) on the projected rectilinear frames, 2) on the whole equirectangular image, with the filters widened by 1/cos(latitude) and wrapped at the seam (the HMD simulation is not applied). [default]: 1")
 	;
 
 	po::options_description dsp("Visualization of results options");
@@ -154,6 +175,24 @@ int main(int argc, char **argv) {
 		("target-width", po::value< int >(), "Choose the width of the output saliency map. -1 for same as source. Default [2048]")
 		("target-height", po::value< int >(), "Choose the height of the output saliency map. -1 for same as source. Default [1024]")
 		("erosion-kernel", po::value< int >(), "Set a post-process erosion kernel. 0 disable it. Default [32]")
+		("sparse-graph", po::value< double >(), "Use a sparse graph in the GBVS activation: edges with a weight below the provided cutoff are dropped (e.g. 0.001). [default]: dense graph")
+		("graph-engine", po::value< int >(), "Engine of the GBVS activation: 1) the markov matrix is built, 2) matrix-free markov chain. [default]: 1")
+		("activation-batch", po::value< int >(), "Number of feature maps solved together by a GBVS activation job (matrix-free engine only). [default]: 1")
+		("single-precision", "The markov chains of the GBVS activation are computed in single precision (matrix-free engine only).")
+		("eigen-solver", po::value< int >(), "Eigenvector solver of the GBVS activation: 1) power iterations, 2) power iterations with Aitken extrapolation (matrix-free engine only). [default]: 1")
+		("warm-start", "The eigenvector iterations of the GBVS activation start from the map instead of the uniform vector (matrix-free engine only).")
+		("report-iterations", "Print the number of iterations of the GBVS activation and normalization of each map.")
+		("graph-cache", po::value< std::string >(), "Directory where the graphs of the GBVS activation are stored. They are loaded from it instead of being built at each run, and added to it when missing.")
+#ifdef WITH_FFTW
+		("csf", "Apply the contrast sensitivity function to the luminance in GBVS.")
+		("fft-wisdom", po::value< std::string >(), "File where the FFTW plans of the contrast sensitivity function are saved and loaded from. Empty to disable it. [default]: wisdom3.txt")
+#endif
+		("back-projection", po::value< int >(), "Back-projection of the feature maps to the equirectangular domain: 1) each map on its own, 2) the maps with the same resolution are packed and back-projected together. [default]: 2")
+		("tiling", po::value< int >(), "Centres of the projected frames: 1) regular azimuth x elevation grid, 2) uniform on the sphere (Fibonacci spiral), with the least frames covering it, 3) the 6 faces of a cube map (requires square frames, ignores the aperture). [default]: 1")
+		("tile-overlap", po::value< double >(), "Overlap ratio between the neighbouring frames of the spiral tiling. [default]: 0.2")
+		("cube-guard-band", po::value< double >(), "Guard band added around the faces of the cube map, as a ratio of the half face. The faces are blended over it. [default]: 0.1")
+		("sphere-graph", po::value< int >(), "Graph of the activation: 0) the grid of the equirectangular feature maps, k) the near-uniform icosahedral grid of the sphere with k subdivisions (10*4^k+2 nodes, e.g. 3 for 642 nodes), k <= 7, and k <= 5 without --sparse-graph. Not available with the scanpaths. [default]: 0")
+		("feature-front-end", po::value< int >(), "Extraction of the features of GBVS360: 1) on the projected rectilinear frames, 2) on the whole equirectangular image, with the filters widened by 1/cos(latitude) and wrapped at the seam (the HMD simulation is not applied). [default]: 1")
 	;
 
 #endif
@@ -260,6 +299,73 @@ int main(int argc, char **argv) {
 		Option::scanPath = vm["scan-path"].as< std::string >();
 	}
 
+	if(vm.count("sparse-graph")) {
+		Option::sparseGraphCutoff = vm["sparse-graph"].as< double >();
+	}
+
+	if(vm.count("graph-engine")) {
+		Option::graphEngine = vm["graph-engine"].as< int >();
+	}
+
+	if(vm.count("activation-batch")) {
+		Option::activationBatch = vm["activation-batch"].as< int >();
+	}
+
+	if(vm.count("single-precision")) {
+		Option::singlePrecision = true;
+	}
+
+	if(vm.count("eigen-solver")) {
+		Option::eigenSolver = vm["eigen-solver"].as< int >();
+	}
+
+	if(vm.count("warm-start")) {
+		Option::warmStart = true;
+	}
+
+	if(vm.count("report-iterations")) {
+		Option::reportIterations = true;
+	}
+
+	if(vm.count("graph-cache")) {
+		FrameCache::setDirectory(vm["graph-cache"].as< std::string >());
+	}
+
+	if(vm.count("back-projection")) {
+		Option::backProjection = vm["back-projection"].as< int >();
+	}
+
+	if(vm.count("tiling")) {
+		Option::tiling = vm["tiling"].as< int >();
+	}
+
+	if(vm.count("tile-overlap")) {
+		Option::tileOverlap = vm["tile-overlap"].as< double >();
+	}
+
+	if(vm.count("cube-guard-band")) {
+		Option::cubeGuardBand = vm["cube-guard-band"].as< double >();
+	}
+
+	if(vm.count("sphere-graph")) {
+		Option::sphereGraph = vm["sphere-graph"].as< int >();
+	}
+
+	if(vm.count("feature-front-end")) {
+		Option::featureFrontEnd = vm["feature-front-end"].as< int >();
+	}
+
+#ifdef WITH_FFTW
+	// the CSF needs the FFT: without it, the option is not registered and rejected by the parser
+	if(vm.count("csf")) {
+		Option::useCSF = true;
+	}
+
+	if(vm.count("fft-wisdom")) {
+		FFTPlans::setWisdomFile(vm["fft-wisdom"].as< std::string >());
+	}
+#endif
+
 	if(vm.count("proj-max-dim")) {
 		saliency360.projMaxDim = vm["proj-max-dim"].as< int >();
 	}
@@ -295,6 +401,9 @@ int main(int argc, char **argv) {
 		Option::threads = 8;
 	}
 
+	// the pool runs all the stages, the calling thread is the last participant
+	ThreadPool::global().resize(static_cast<int>(Option::threads) - 1);
+
 
 	// ---------------------------------------------------------------------------------------------------
 	// Saliency BMS settings
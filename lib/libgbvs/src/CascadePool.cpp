@@ -0,0 +1,105 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#include "CascadePool.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+
+
+CascadePool& CascadePool::global() {
+	static CascadePool pool;
+	return pool;
+}
+
+
+CascadePool::CascadePool() {
+	m_File[FrontalFace] = "haarcascade_frontalface_alt.xml";
+	m_File[EyeGlasses]  = "haarcascade_eye_tree_eyeglasses.xml";
+
+	for(int i = 0 ; i < NbModels ; ++i) {
+		m_Loaded[i] 	= false;
+		m_Available[i] 	= false;
+	}
+}
+
+
+
+// read the XML of the model, once. Must be called with the mutex locked.
+bool CascadePool::loadXml(Model model) {
+	if(m_Loaded[model])
+		return m_Available[model];
+
+	m_Loaded[model] = true;
+
+	std::ifstream file(m_File[model].c_str());
+	if(!file) {
+		std::cerr<< "[I] cannot open: " << m_File[model] << std::endl;
+		return false;
+	}
+
+	std::ostringstream content;
+	content << file.rdbuf();
+	m_Xml[model] = content.str();
+	m_Available[model] = !m_Xml[model].empty();
+
+	return m_Available[model];
+}
+
+
+
+cv::CascadeClassifier* CascadePool::get(Model model) {
+	Classifiers *classifiers = m_Classifiers.get();
+	if(classifiers == NULL) {
+		classifiers = new Classifiers();
+		for(int i = 0 ; i < NbModels ; ++i) {
+			classifiers->tried[i] 	  = false;
+			classifiers->available[i] = false;
+		}
+		m_Classifiers.reset(classifiers);
+	}
+
+	if(!classifiers->tried[model]) {
+		classifiers->tried[model] = true;
+
+		{
+			boost::mutex::scoped_lock lock(m_Mutex);
+			if(!loadXml(model))
+				return NULL;
+		}
+
+		// m_Xml is not modified once loaded: the parsing does not need the lock.
+		cv::FileStorage storage(m_Xml[model], cv::FileStorage::READ | cv::FileStorage::MEMORY);
+		classifiers->available[model] = storage.isOpened() && classifiers->cascade[model].read(storage.getFirstTopLevelNode());
+
+		// cascades in the old format can only be read from the file
+		if(!classifiers->available[model]) 
+			classifiers->available[model] = classifiers->cascade[model].load(m_File[model]);
+
+		if(!classifiers->available[model])
+			std::cerr<< "[I] cannot read the cascade: " << m_File[model] << std::endl;
+	}
+
+	return classifiers->available[model] ? &classifiers->cascade[model] : NULL;
+}
@@ -0,0 +1,77 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _CASCADEPOOL_
+#define _CASCADEPOOL_
+
+#include <string>
+#include <opencv2/objdetect.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+
+// Haar cascades of the face channel. cv::CascadeClassifier cannot be used by several threads at once:
+// each thread gets its own classifiers. The XML files are read once per process and kept in memory, 
+// the copies of a thread are parsed from it the first time the thread runs a detection, and are kept 
+// for the next images (the threads of the pool are persistent).
+
+class CascadePool {
+
+public:
+
+	enum Model {
+		FrontalFace = 0,		// haarcascade_frontalface_alt.xml
+		EyeGlasses,				// haarcascade_eye_tree_eyeglasses.xml
+		NbModels
+	};
+
+
+	static CascadePool& 		global 		();
+
+	// classifier of the calling thread. NULL if the model could not be loaded.
+	cv::CascadeClassifier* 		get 		(Model model);
+
+
+private:
+
+								CascadePool ();
+
+	bool 						loadXml 	(Model model);
+
+
+	struct Classifiers {
+		cv::CascadeClassifier 	cascade[NbModels];
+		bool 					tried[NbModels];
+		bool 					available[NbModels];
+	};
+
+	boost::mutex 								m_Mutex;
+	std::string 								m_File[NbModels];
+	std::string 								m_Xml[NbModels];
+	bool 										m_Loaded[NbModels];
+	bool 										m_Available[NbModels];
+
+	boost::thread_specific_ptr<Classifiers> 	m_Classifiers;
+};
+
+
+#endif
@@ -0,0 +1,59 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _DKL_
+#define _DKL_
+
+#include <opencv2/core.hpp>
+
+
+// Conversion of the R, G, B planes ([0, 1]) to the DKL planes of the 'D' channel: each channel goes 
+// through the 256 entries gamma LUT, then to LMS and to DKL, and the planes are scaled by 0.5774,
+// 2.7525 and 0.4526.
+//
+// The two 3x3 matrices and the scales are folded into the LUT: there is one table of 256 DKL triplets 
+// per input channel, so a pixel costs three lookups and the sum of three triplets. With AVX2, the 
+// lookups of 4 pixels are done with gathers. The result differs from the pixel by pixel evaluation 
+// of the matrices by the rounding of the folded coefficients (~1e-15).
+
+class DKLTable {
+
+public:
+
+	static const DKLTable& 	instance 	();
+
+	// the outputs must be allocated with the size of the inputs (CV_64FC1), and can be views on a larger buffer
+	void 					convert 	(const cv::Mat &imgR, const cv::Mat &imgG, const cv::Mat &imgB, cv::Mat &imgL, cv::Mat &imgC1, cv::Mat &imgC2) const;
+
+
+private:
+
+							 DKLTable 	();
+
+	static int 				index 		(double v);
+
+	double 					m_Table[3][3][256];		// [input channel][DKL plane][LUT index]
+	double 					m_Offset[3];
+};
+
+
+#endif
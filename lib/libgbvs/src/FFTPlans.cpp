@@ -0,0 +1,109 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#include "FFTPlans.h"
+
+#ifdef WITH_FFTW
+
+#include <iostream>
+#include <stdexcept>
+
+
+boost::mutex 								FFTPlans::s_mutex;
+std::map<FFTPlans::Key, fftw_plan> 			FFTPlans::s_plans;
+std::string 								FFTPlans::s_wisdomFile = "wisdom3.txt";
+bool 										FFTPlans::s_wisdomLoaded = false;
+
+
+
+void FFTPlans::setWisdomFile(const std::string &path) {
+	boost::mutex::scoped_lock lock(s_mutex);
+	s_wisdomFile = path;
+	s_wisdomLoaded = false;
+}
+
+
+void FFTPlans::clear() {
+	boost::mutex::scoped_lock lock(s_mutex);
+
+	for(std::map<Key, fftw_plan>::iterator it = s_plans.begin() ; it != s_plans.end() ; ++it) {
+		fftw_destroy_plan(it->second);
+	}
+	s_plans.clear();
+}
+
+
+
+fftw_plan FFTPlans::plan(int width, int height, int direction) {
+	boost::mutex::scoped_lock lock(s_mutex);
+
+	Key key(std::make_pair(width, height), direction);
+	std::map<Key, fftw_plan>::iterator it = s_plans.find(key);
+	if(it != s_plans.end())
+		return it->second;
+
+	if(!s_wisdomLoaded && !s_wisdomFile.empty()) {
+		// a missing file is not an error: it is created with the first plan
+		fftw_import_wisdom_from_filename(s_wisdomFile.c_str());
+		s_wisdomLoaded = true;
+	}
+
+	// FFTW_MEASURE overwrites the arrays: the plan is made on scratch arrays
+	size_t nbComplex = static_cast<size_t>(height) * (width/2 + 1);
+	double 		 *real 	 = fftw_alloc_real(2 * nbComplex);
+	fftw_complex *complex = fftw_alloc_complex(nbComplex);
+
+	fftw_plan p;
+	if(direction < 0)
+		p = fftw_plan_dft_r2c_2d(height, width, real, complex, FFTW_MEASURE);
+	else
+		p = fftw_plan_dft_c2r_2d(height, width, complex, real, FFTW_MEASURE);
+
+	fftw_free(real);
+	fftw_free(complex);
+
+	if(p == NULL) {
+		throw std::logic_error(std::string("FFTPlans::plan(): Unable to construct the FFTW plan."));
+	}
+
+	s_plans[key] = p;
+
+	if(!s_wisdomFile.empty() && !fftw_export_wisdom_to_filename(s_wisdomFile.c_str())) {
+		std::cerr << "[I] cannot save the FFTW wisdom to: " << s_wisdomFile << std::endl;
+	}
+
+	return p;
+}
+
+
+
+void FFTPlans::forward(int width, int height, double *in, fftw_complex *out) {
+	fftw_execute_dft_r2c(plan(width, height, FFTW_FORWARD), in, out);
+}
+
+
+void FFTPlans::backward(int width, int height, fftw_complex *in, double *out) {
+	fftw_execute_dft_c2r(plan(width, height, FFTW_BACKWARD), in, out);
+}
+
+
+#endif
@@ -0,0 +1,77 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _FFTPLANS_
+#define _FFTPLANS_
+
+#include "GBVS.h" 	// WITH_FFTW
+
+#ifdef WITH_FFTW
+
+#include <map>
+#include <string>
+#include <fftw3.h>
+#include <boost/thread/mutex.hpp>
+
+
+// Process-wide cache of the FFTW plans of the 2D real transforms, keyed by (width, height, direction). 
+// A plan is created once, for the first image of its size, and then shared by all the GBVS instances:
+// FFTW plans can be executed concurrently with the new-array interface, only their creation has to be 
+// serialized. The arrays must be allocated with fftw_malloc (fftw_alloc_real, fftw_alloc_complex) to 
+// have the alignment of the planning arrays.
+//
+// The wisdom file is loaded before the first plan is created, and saved after each new plan, so the
+// next processes skip the measurements.
+
+class FFTPlans {
+
+public:
+
+	// real to complex transform of height x width values. out: height x (width/2+1) complex values.
+	static void 			forward 		(int width, int height, double *in, fftw_complex *out);
+
+	// complex to real transform (not normalized: the values are scaled by width*height). in is destroyed.
+	static void 			backward 		(int width, int height, fftw_complex *in, double *out);
+
+	// wisdom file. [default]: wisdom3.txt, empty disables it.
+	static void 			setWisdomFile 	(const std::string &path);
+
+	// destroy the plans. Must not be called during a transform.
+	static void 			clear 			();
+
+
+private:
+
+	typedef std::pair< std::pair<int,int>, int > Key;
+
+	static fftw_plan 		plan 			(int width, int height, int direction);
+
+	static boost::mutex 					s_mutex;
+	static std::map<Key, fftw_plan> 		s_plans;
+	static std::string 						s_wisdomFile;
+	static bool 							s_wisdomLoaded;
+};
+
+
+#endif
+
+#endif
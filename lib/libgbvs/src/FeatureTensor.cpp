@@ -0,0 +1,109 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#include "FeatureTensor.h"
+
+#include <stdexcept>
+
+
+
+FeatureTensor::FeatureTensor() {
+	m_Channels 	= 0;
+	m_Levels 	= 0;
+	m_Types 	= 0;
+	m_Rows 		= 0;
+	m_Cols 		= 0;
+}
+
+
+void FeatureTensor::reshape(int nbChannels, int nbLevels, int nbTypes, int rows, int cols) {
+	if(nbChannels < 0 || nbLevels < 0 || nbTypes < 0 || rows <= 0 || cols <= 0) {
+		throw std::logic_error(std::string("FeatureTensor::reshape(): invalid shape."));
+	}
+
+	int nbSlots = nbChannels * nbLevels * nbTypes;
+	bool sameShape = nbChannels == m_Channels && nbLevels == m_Levels && nbTypes == m_Types && rows == m_Rows && cols == m_Cols && !m_Arena.empty();
+
+	m_Channels 	= nbChannels;
+	m_Levels 	= nbLevels;
+	m_Types 	= nbTypes;
+	m_Rows 		= rows;
+	m_Cols 		= cols;
+
+	if(!sameShape) {
+		int nbViews = nbSlots + nbChannels;
+		m_Arena.create(nbViews * rows, cols, CV_64FC1);
+
+		m_Views.resize(nbViews);
+		for(int i = 0 ; i < nbViews ; ++i) {
+			m_Views[i] = m_Arena.rowRange(i * rows, (i+1) * rows);
+		}
+	}
+
+	m_Used.assign(nbSlots, 0);
+}
+
+
+void FeatureTensor::clear() {
+	m_Used.assign(m_Used.size(), 0);
+}
+
+
+int FeatureTensor::slot(int channel, int level, int type) const {
+	if(channel < 0 || channel >= m_Channels || level < 0 || level >= m_Levels || type < 0 || type >= m_Types)
+		return -1;
+
+	return (channel * m_Levels + level) * m_Types + type;
+}
+
+
+cv::Mat FeatureTensor::map(int channel, int level, int type) {
+	int s = slot(channel, level, type);
+	if(s < 0) {
+		throw std::logic_error(std::string("FeatureTensor::map(): the map is outside of the tensor."));
+	}
+
+	if(m_Used[s]) {
+		throw std::logic_error(std::string("FeatureTensor::map(): the map is already in the tensor."));
+	}
+
+	m_Used[s] = 1;
+	return m_Views[s];
+}
+
+
+const cv::Mat* FeatureTensor::find(int channel, int level, int type) const {
+	int s = slot(channel, level, type);
+	if(s < 0 || !m_Used[s])
+		return NULL;
+
+	return &m_Views[s];
+}
+
+
+cv::Mat FeatureTensor::channel(int channel) {
+	if(channel < 0 || channel >= m_Channels) {
+		throw std::logic_error(std::string("FeatureTensor::channel(): the channel is outside of the tensor."));
+	}
+
+	return m_Views[m_Channels * m_Levels * m_Types + channel];
+}
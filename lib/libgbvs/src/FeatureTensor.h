@@ -0,0 +1,84 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _FEATURETENSOR_
+#define _FEATURETENSOR_
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+
+// Storage of the maps of the activation, indexed by [channel][level][type]. All the maps have the 
+// geometry of the graph: they are stored in one CV_64FC1 arena, followed by one plane per channel 
+// where the maps of a channel are summed. The maps are accessed through views (headers sharing the 
+// arena): they must be written in place (copyTo, operators with the view as destination), an 
+// assignment would detach the header from the arena.
+//
+// The arena is only reallocated when the shape changes, so the same instance can be reused from an
+// image to the next one.
+
+class FeatureTensor {
+
+public:
+
+					FeatureTensor 	();
+
+	// shape of the tensor and geometry of the maps. All the slots are marked empty.
+	void 			reshape 		(int nbChannels, int nbLevels, int nbTypes, int rows, int cols);
+
+	// mark all the slots empty, and keep the memory
+	void 			clear 			();
+
+	// view on the slot (channel, level, type), which is marked used. A slot is given once until clear() or reshape().
+	cv::Mat 		map 			(int channel, int level, int type);
+
+	// view on the slot, NULL if it is empty or outside of the tensor
+	const cv::Mat* 	find 			(int channel, int level, int type) const;
+
+	// view on the plane of a channel
+	cv::Mat 		channel 		(int channel);
+
+
+	int 			channels 		() const 			{ return m_Channels; }
+	int 			levels 			() const 			{ return m_Levels; }
+	int 			types 			() const 			{ return m_Types; }
+	int 			rows 			() const 			{ return m_Rows; }
+	int 			cols 			() const 			{ return m_Cols; }
+
+
+private:
+
+	int 			slot 			(int channel, int level, int type) const;
+
+	int 					m_Channels;
+	int 					m_Levels;
+	int 					m_Types;
+	int 					m_Rows;
+	int 					m_Cols;
+
+	cv::Mat 				m_Arena;
+	std::vector<cv::Mat> 	m_Views;		// slots, then channel planes
+	std::vector<char> 		m_Used;
+};
+
+
+#endif
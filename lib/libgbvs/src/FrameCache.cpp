@@ -0,0 +1,323 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#include "FrameCache.h"
+#include "GBVS.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#ifdef _WIN32
+	#include <process.h>
+	#define getpid _getpid
+#else
+	#include <unistd.h>
+#endif
+
+boost::mutex 										FrameCache::s_mutex;
+std::map< std::string, boost::shared_ptr<FrameCache::Entry> > FrameCache::s_frames;
+std::string 										FrameCache::s_directory;
+
+
+
+boost::shared_ptr<const Frame> FrameCache::get(const std::string &key, const FrameBuilder &builder) {
+
+	boost::shared_ptr<Entry> entry;
+	std::string directory;
+
+	{
+		boost::mutex::scoped_lock lock(s_mutex);
+		boost::shared_ptr<Entry> &slot = s_frames[key];
+		if(!slot)
+			slot = boost::shared_ptr<Entry>(new Entry());
+
+		entry = slot;
+		directory = s_directory;
+	}
+
+	// the registry is not locked while the frame is built, only the requests for the same key wait.
+	boost::mutex::scoped_lock lock(entry->mutex);
+	if(entry->frame)
+		return entry->frame;
+
+	std::string path;
+	if(!directory.empty()) {
+		path = directory + "/" + filename(key);
+		entry->frame = read(path, key);
+		if(entry->frame)
+			return entry->frame;
+	}
+
+	boost::shared_ptr<Frame> frame(new Frame());
+	builder(*frame);
+	entry->frame = frame;
+
+	// fill the on-disk cache
+	if(!path.empty() && write(path, key, *frame)) {
+		std::cerr << "[I] graph stored in: " << path << std::endl;
+	}
+
+	return entry->frame;
+}
+
+
+
+void FrameCache::clear() {
+	boost::mutex::scoped_lock lock(s_mutex);
+	s_frames.clear();
+}
+
+
+
+void FrameCache::setDirectory(const std::string &directory) {
+	boost::mutex::scoped_lock lock(s_mutex);
+	s_directory = directory;
+}
+
+
+
+// the key contains characters which are not welcome in file names: use its hash (the key is checked when loading)
+std::string FrameCache::filename(const std::string &key) {
+	boost::uint64_t hash = 14695981039346656037ULL;
+	for(size_t i = 0 ; i < key.size() ; ++i) {
+		hash ^= static_cast<unsigned char>(key[i]);
+		hash *= 1099511628211ULL;
+	}
+
+	std::ostringstream name;
+	name << "frame_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".gbvsframe";
+	return name.str();
+}
+
+
+
+
+// ==============================================================================================================================
+// binary format
+//
+// 	FileHeader
+// 	key 						(keySize chars)
+// 	dims 						(nbDims pairs of int32)
+// 	multilevels 				(nbMultilevels int32)
+// 	lx 							(lxRows x lxCols doubles, row major)
+// 	d 							(dRows x dCols doubles, row major)
+// 	sparse.rowPtr 				(nbRowPtr int32)
+// 	sparse.colIdx 				(nnz int32)
+// 	sparse.d 					(nnz doubles)
+//
+// each section starts on a 8 bytes boundary so that the matrices can be used directly from the mapping.
+
+
+namespace {
+
+	const char 				FRAME_MAGIC[8] 	= {'G','B','V','S','F','R','M','\0'};
+	const boost::uint32_t 	FRAME_VERSION 	= 1;
+	const boost::uint32_t 	FRAME_ENDIAN 	= 0x01020304;
+
+	struct FileHeader {
+		char 			magic[8];
+		boost::uint32_t version;
+		boost::uint32_t endian;
+		boost::uint64_t keySize;
+		boost::uint64_t nbDims;
+		boost::uint64_t nbMultilevels;
+		boost::uint64_t lxRows;
+		boost::uint64_t lxCols;
+		boost::uint64_t dRows;
+		boost::uint64_t dCols;
+		boost::uint64_t nbRowPtr;
+		boost::uint64_t nnz;
+	};
+
+	size_t align8(size_t offset) {
+		return (offset + 7) & ~static_cast<size_t>(7);
+	}
+
+	void writeSection(std::ofstream &file, const void *data, size_t size) {
+		if(size > 0)
+			file.write(reinterpret_cast<const char*>(data), size);
+
+		static const char padding[8] = {0};
+		size_t pad = align8(size) - size;
+		if(pad > 0)
+			file.write(padding, pad);
+	}
+
+	void writeMat(std::ofstream &file, const cv::Mat &m) {
+		for(int i = 0 ; i < m.rows ; ++i) {
+			file.write(reinterpret_cast<const char*>(m.ptr<double>(i)), m.cols * sizeof(double));
+		}
+	}
+}
+
+
+
+bool FrameCache::write(const std::string &path, const std::string &key, const Frame &frame) {
+
+	FileHeader header;
+	std::memcpy(header.magic, FRAME_MAGIC, sizeof(FRAME_MAGIC));
+	header.version 			= FRAME_VERSION;
+	header.endian 			= FRAME_ENDIAN;
+	header.keySize 			= key.size();
+	header.nbDims 			= frame.dims.size();
+	header.nbMultilevels 	= frame.multilevels.size();
+	header.lxRows 			= frame.lx.rows;
+	header.lxCols 			= frame.lx.cols;
+	header.dRows 			= frame.d.rows;
+	header.dCols 			= frame.d.cols;
+	header.nbRowPtr 		= frame.sparse.rowPtr.size();
+	header.nnz 				= frame.sparse.colIdx.size();
+
+	std::vector<boost::int32_t> dims;
+	for(size_t i = 0 ; i < frame.dims.size() ; ++i) {
+		dims.push_back(frame.dims[i].first);
+		dims.push_back(frame.dims[i].second);
+	}
+	std::vector<boost::int32_t> multilevels(frame.multilevels.begin(), frame.multilevels.end());
+
+	// write to a temporary file first, so that another process never maps a partially written frame
+	std::ostringstream tmpPath;
+	tmpPath << path << ".tmp" << getpid() << "_" << boost::this_thread::get_id();
+
+	{
+		std::ofstream file(tmpPath.str().c_str(), std::ios::binary | std::ios::trunc);
+		if(!file.is_open()) {
+			std::cerr << "[W] FrameCache: cannot write " << path << std::endl;
+			return false;
+		}
+
+		writeSection(file, &header, sizeof(header));
+		writeSection(file, key.data(), key.size());
+		writeSection(file, dims.data(), dims.size() * sizeof(boost::int32_t));
+		writeSection(file, multilevels.data(), multilevels.size() * sizeof(boost::int32_t));
+		writeMat(file, frame.lx);
+		writeMat(file, frame.d);
+		writeSection(file, frame.sparse.rowPtr.data(), frame.sparse.rowPtr.size() * sizeof(int));
+		writeSection(file, frame.sparse.colIdx.data(), frame.sparse.colIdx.size() * sizeof(int));
+		writeSection(file, frame.sparse.d.data(), frame.sparse.d.size() * sizeof(double));
+
+		if(!file.good()) {
+			std::cerr << "[W] FrameCache: cannot write " << path << std::endl;
+			file.close();
+			std::remove(tmpPath.str().c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	if(std::rename(tmpPath.str().c_str(), path.c_str()) != 0) {
+		std::remove(tmpPath.str().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+
+
+boost::shared_ptr<const Frame> FrameCache::read(const std::string &path, const std::string &key) {
+	namespace bip = boost::interprocess;
+
+	boost::shared_ptr<bip::mapped_region> region;
+
+	try {
+		bip::file_mapping mapping(path.c_str(), bip::read_only);
+		// copy_on_write: the frame is read-only, but this guarantees the file is never modified
+		region = boost::shared_ptr<bip::mapped_region>(new bip::mapped_region(mapping, bip::copy_on_write));
+	} catch(bip::interprocess_exception &) {
+		return boost::shared_ptr<const Frame>();
+	}
+
+	const char *data = static_cast<const char*>(region->get_address());
+	size_t 		size = region->get_size();
+
+	if(size < sizeof(FileHeader))
+		return boost::shared_ptr<const Frame>();
+
+	FileHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if(std::memcmp(header.magic, FRAME_MAGIC, sizeof(FRAME_MAGIC)) != 0 || header.endian != FRAME_ENDIAN) {
+		std::cerr << "[W] FrameCache: " << path << " is not a frame file" << std::endl;
+		return boost::shared_ptr<const Frame>();
+	}
+
+	if(header.version != FRAME_VERSION) {
+		std::cerr << "[W] FrameCache: " << path << " has version " << header.version << ", expected " << FRAME_VERSION << std::endl;
+		return boost::shared_ptr<const Frame>();
+	}
+
+	// locate all the sections and make sure the file is complete
+	size_t offset = align8(sizeof(FileHeader));
+	size_t keyOffset 	= offset; 	offset += align8(header.keySize);
+	size_t dimsOffset 	= offset; 	offset += align8(header.nbDims * 2 * sizeof(boost::int32_t));
+	size_t levelsOffset = offset; 	offset += align8(header.nbMultilevels * sizeof(boost::int32_t));
+	size_t lxOffset 	= offset; 	offset += header.lxRows * header.lxCols * sizeof(double);
+	size_t dOffset 		= offset; 	offset += header.dRows * header.dCols * sizeof(double);
+	size_t rowPtrOffset = offset; 	offset += align8(header.nbRowPtr * sizeof(boost::int32_t));
+	size_t colIdxOffset = offset; 	offset += align8(header.nnz * sizeof(boost::int32_t));
+	size_t sparseOffset = offset; 	offset += header.nnz * sizeof(double);
+
+	if(offset > size) {
+		std::cerr << "[W] FrameCache: " << path << " is truncated" << std::endl;
+		return boost::shared_ptr<const Frame>();
+	}
+
+	if(std::string(data + keyOffset, header.keySize) != key) {
+		std::cerr << "[W] FrameCache: " << path << " holds a different graph" << std::endl;
+		return boost::shared_ptr<const Frame>();
+	}
+
+	boost::shared_ptr<Frame> frame(new Frame());
+
+	const boost::int32_t *dims = reinterpret_cast<const boost::int32_t*>(data + dimsOffset);
+	for(size_t i = 0 ; i < header.nbDims ; ++i) {
+		frame->dims.push_back(std::pair<int, int>(dims[2*i], dims[2*i+1]));
+	}
+
+	const boost::int32_t *levels = reinterpret_cast<const boost::int32_t*>(data + levelsOffset);
+	frame->multilevels.assign(levels, levels + header.nbMultilevels);
+
+	// the matrices point to the mapping (no copy). The region is released with the frame.
+	char *mapped = static_cast<char*>(region->get_address());
+	if(header.lxRows > 0)
+		frame->lx = cv::Mat(static_cast<int>(header.lxRows), static_cast<int>(header.lxCols), CV_64FC1, mapped + lxOffset);
+	if(header.dRows > 0)
+		frame->d  = cv::Mat(static_cast<int>(header.dRows), static_cast<int>(header.dCols), CV_64FC1, mapped + dOffset);
+
+	// so do the arrays of the sparse graph
+	frame->sparse.rowPtr = ArrayView<int>(reinterpret_cast<const int*>(data + rowPtrOffset), header.nbRowPtr);
+	frame->sparse.colIdx = ArrayView<int>(reinterpret_cast<const int*>(data + colIdxOffset), header.nnz);
+	frame->sparse.d 	 = ArrayView<double>(reinterpret_cast<const double*>(data + sparseOffset), header.nnz);
+
+	frame->storage = region;
+
+	return frame;
+}
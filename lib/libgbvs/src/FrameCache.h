@@ -0,0 +1,77 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+#ifndef _FRAMECACHE_
+#define _FRAMECACHE_
+
+#include <map>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+struct Frame;
+
+
+// Process-wide registry of the graphs used by the GBVS activation. A graph only depends on its 
+// parameters (map size, multilevels, cyclic type, ...), which are summarized by the key. It is built
+// once by the first instance which needs it, and then shared read-only by all the GBVS instances.
+//
+// If a cache directory is set, the frames are also stored on disk (one file per key) and memory
+// mapped by the next processes instead of being built again.
+
+class FrameCache {
+
+public:
+
+	typedef boost::function<void (Frame&)> FrameBuilder;
+
+	// return the frame registered under key. If there is none, build it with builder. Concurrent
+	// requests for the same key wait for the first one, and the frame is built only once.
+	static boost::shared_ptr<const Frame> 	get		(const std::string &key, const FrameBuilder &builder);
+
+	// release the registered frames. The frames still used by a GBVS instance stay alive until it is destroyed.
+	static void 							clear	();
+
+	// directory used to load/store the frames. Empty (default) disables the on-disk cache.
+	static void 							setDirectory(const std::string &directory);
+	static std::string 						filename	(const std::string &key);
+
+
+	// binary frame files. read() maps the file in memory, the matrices and the sparse graph of the frame point to the mapping.
+	static bool 							write	(const std::string &path, const std::string &key, const Frame &frame);
+	static boost::shared_ptr<const Frame> 	read	(const std::string &path, const std::string &key);
+
+
+private:
+
+	struct Entry {
+		boost::mutex 					mutex;
+		boost::shared_ptr<const Frame> 	frame;
+	};
+
+	static boost::mutex 									s_mutex;
+	static std::map< std::string, boost::shared_ptr<Entry> > s_frames;
+	static std::string 										s_directory;
+
+};
+
+
+#endif
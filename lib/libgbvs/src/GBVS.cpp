@@ -21,22 +21,26 @@
 
 
 #include "GBVS.h"
+#include "FrameCache.h"
+#include "MarkovChain.h"
+#include "ThreadPool.h"
+#include "LowPass.h"
+#include "DKL.h"
+#include "FFTPlans.h"
+#include "CascadePool.h"
 #include <iostream>
 #include <list>
+#include <algorithm>
 #include <cmath>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 #include <limits>
+#include <sstream>
+#include <iomanip>
 #include <boost/lexical_cast.hpp>
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 
-#ifdef WITH_FFTW
-	int 			 GBVS::instanceCounter = 0;
-	fftwpp::fft2d	*GBVS::forward = NULL;
-	fftwpp::fft2d	*GBVS::backward = NULL;
-#endif
-
 #define WITH_LINPER 1
 #define WITH_MEAN_SHIFT 1
 
@@ -64,12 +68,14 @@ GBVS::GBVS() {
 	linperWeight	= .1f;
 	faceFeatureWeight = 1.5f;
 	blurFeatureWeight = 1.0f;
+	faceDetectionSize = 512;
 
 	gaborangles.resize(4);
 	gaborangles[0] = 0;
 	gaborangles[1] = 45;
 	gaborangles[2] = 90;
 	gaborangles[3] = 135;
+	orientationFilter = GaborBank::Automatic;
 
 	motionAngles.resize(4);
 	motionAngles[0] = 0;
@@ -95,6 +101,15 @@ GBVS::GBVS() {
 	normalizationType = 1;
 	normalizeTopChannelMaps = 0;
 
+	sparseGraph = false;
+	sparseCutoff = 1e-3;
+	graphEngine = 1;
+	activationBatch = 1;
+	singlePrecision = false;
+	eigenSolver = 1;
+	warmStart = false;
+	reportIterations = false;
+
 
 	useCSF = true;
 	viewingDistance = 2.5f;
@@ -104,33 +119,11 @@ GBVS::GBVS() {
 	initDone = false;
 
 
-	initCascadeClassifier = false;
-	faceCascadeEnabled = false;
-	eyeCascadeEnabled = false;
-
-
 	equatorialPrior = false;
 	nbThreads = 2;
-
-
-
-#ifdef WITH_FFTW
-	++instanceCounter;
-#endif
-
 }
 
 GBVS::~GBVS() {
-
-#ifdef WITH_FFTW
-	--instanceCounter;
-
-	if(instanceCounter == 0) {
-		if(forward  != NULL)  delete forward;
-		if(backward != NULL)  delete backward;
-	}
-#endif
-
 }
 
 
@@ -288,11 +281,15 @@ void GBVS::gbvsActivation(const cv::Mat &featureMap, cv::Mat &out, bool normaliz
 	// STEP 2: normalize activation maps
 	normalizeActivation();
 
+	if(reportIterations)
+		printIterations();
+
 	// STEP 3 : average across maps within each feature channel
 	averageByFeatureChannel();
 
 	// STEP 4 : sum across feature channels
 	sumChannels(normalize);
+	renderMasterMap();
 
 	// STEP 5: blur for better results
 	blurMasterMap(normalize);
@@ -349,10 +346,42 @@ void GBVS::initGBVS(const cv::Mat& img_u) {
 }
 
 
+// get the graph used for the activation. It is built only once per set of graph parameters,
+// and shared with all the other GBVS instances.
+void GBVS::graphsalinit(const std::vector<int> &map_size) {
+	grframe = FrameCache::get(frameKey(map_size), boost::bind(&GBVS::buildFrame, this, boost::cref(map_size), _1));
+}
+
+
+
+// everything that changes the content of the frame built by buildFrame()
+std::string GBVS::frameKey(const std::vector<int> &map_size) const {
+	std::ostringstream key;
+	key << map_size[0] << "x" << map_size[1] << ";levels";
+	for(size_t i = 0 ; i < multilevels.size() ; ++i)
+		key << ":" << multilevels[i];
+
+	key << ";cyclic:" << cyclic_type << ";" << distanceModel();
+
+	// the parameters are written exactly: close values must not share a frame
+	if(sparseGraph)
+		key << ";sparse:" << std::setprecision(17) << sparseCutoff << ":" << std::max(sigma_frac_act, sigma_frac_norm);
+
+	return key.str();
+}
+
+
+
+std::string GBVS::distanceModel() const {
+	return "grid";
+}
+
+
+
 // this function creates the weight matrix for making edge weights
 // and saves some other constants (like node-in-lattice index) to a 'frame'
 // used when the graphs are made from saliency/feature maps.
-void GBVS::graphsalinit(const std::vector<int> &map_size) {
+void GBVS::buildFrame(const std::vector<int> &map_size, Frame &frame) const {
 
 	std::vector<cv::Mat> apyr;
 	std::vector< std::pair<int, int> > dims;
@@ -362,13 +391,27 @@ void GBVS::graphsalinit(const std::vector<int> &map_size) {
 
 	getDims(map_size , multilevels, apyr, dims);
 	namenodes(dims, N, nam);
-	grframe.lx = makeLocationMap(dims, nam, N);
-	cv::Mat cx = connectMatrix(dims, grframe.lx, 2, 2 , cyclic_type);
-	cv::Mat dx = distanceMatrix(dims, grframe.lx, cyclic_type);
+	frame.lx = makeLocationMap(dims, nam, N);
 
-	grframe.d = dx.mul(cx);
-	grframe.dims = dims;
-	grframe.multilevels = multilevels;
+	if(sparseGraph) {
+		// all the nodes are connected (inter_type == intra_type == 2), so only the distance decides which edge is kept.
+		// The largest sigma used by graphsalapply gives the largest distance still above the cutoff.
+		double sig = std::max(sigma_frac_act, sigma_frac_norm) * static_cast<double>(map_size[0] + map_size[1])/2.f;
+		double maxDistance = std::numeric_limits<double>::max();
+		if(sparseCutoff > 0)
+			maxDistance = -2 * sig*sig * std::log(sparseCutoff);
+
+		sparseGraphInit(dims, frame.lx, cyclic_type, maxDistance, frame.sparse);
+
+	} else {
+		cv::Mat cx = connectMatrix(dims, frame.lx, 2, 2 , cyclic_type);
+		cv::Mat dx = distanceMatrix(dims, frame.lx, cyclic_type);
+
+		frame.d = dx.mul(cx);
+	}
+
+	frame.dims = dims;
+	frame.multilevels = multilevels;
 
 }
 
@@ -820,6 +863,178 @@ cv::Mat GBVS::simpledistance(const std::pair<int, int>& dim, int cyclic_type) co
 }
 
 
+// distance between the nodes a and b of a map, same value as simpledistance(dim, cyclic_type).at<double>(a,b)
+double GBVS::nodedistance(const std::pair<int, int>& dim, int cyclic_type, int a, int b) const {
+	int i  = a / dim.first;
+	int j  = a % dim.first;
+	int ii = b / dim.first;
+	int jj = b % dim.first;
+
+	double di = 0.f;
+	double dj = 0.f;
+
+	if ( cyclic_type==1 ) {
+		di = std::min( std::abs(i-ii) , std::abs( std::abs(i-ii) - dim.second ) );
+		dj = std::min( std::abs(j-jj) , std::abs( std::abs(j-jj) - dim.first ) );
+	} else {
+		di = i-ii;
+		dj = j-jj;
+	}
+
+	return di*di+dj*dj;
+}
+
+
+
+void SparseGraph::assign(std::vector<int> &rowPtr, std::vector<int> &colIdx, std::vector<double> &d) {
+	m_RowPtr.swap(rowPtr);
+	m_ColIdx.swap(colIdx);
+	m_D.swap(d);
+
+	this->rowPtr = ArrayView<int>(m_RowPtr.data(), m_RowPtr.size());
+	this->colIdx = ArrayView<int>(m_ColIdx.data(), m_ColIdx.size());
+	this->d 	 = ArrayView<double>(m_D.data(), m_D.size());
+}
+
+
+
+// largest offset, in rows or in columns of dim, between two pixels whose nodedistance() is not above maxDistance
+int GBVS::nodereach(const std::pair<int, int>& dim, int , double maxDistance) const {
+	double diagonal = static_cast<double>(dim.first)*dim.first + static_cast<double>(dim.second)*dim.second;
+	if(!(maxDistance < diagonal))
+		return std::max(dim.first, dim.second);
+
+	return static_cast<int>(std::ceil(std::sqrt(std::max(maxDistance, 0.0))));
+}
+
+
+
+// rows (or columns) [lo, hi] of a map of n rows, wrapped when the map is cyclic and clamped otherwise
+static void windowRange(int lo, int hi, int n, bool cyclic, std::vector<int> &range) {
+	range.clear();
+
+	if(cyclic && hi - lo + 1 >= n) {
+		lo = 0;
+		hi = n-1;
+	} else if(!cyclic) {
+		lo = std::max(lo, 0);
+		hi = std::min(hi, n-1);
+	}
+
+	for(int t = lo ; t <= hi ; ++t) {
+		range.push_back(((t % n) + n) % n);
+	}
+}
+
+
+
+// same distances as distanceMatrix(), but only the edges with a distance lower than maxDistance are stored.
+// The distance of two nodes is the mean distance of their locations in the finest map: a node whose locations
+// are all more than nodereach() rows or columns away from the locations of r cannot be a neighbour of r. So the
+// nodes of each level are indexed by the top left corner of their locations, and only the nodes whose corner is
+// in a window around the locations of r are visited.
+void GBVS::sparseGraphInit(const std::vector< std::pair<int, int> >& dims, 
+						   const cv::Mat&  lx, 
+						   int cyclic_type, 
+						   double maxDistance, 
+						   SparseGraph &graph) const {
+
+	const int rows = dims[0].second;
+	const int cols = dims[0].first;
+	const bool cyclic = cyclic_type == 1;
+	const int reach = nodereach(dims[0], cyclic_type, maxDistance);
+
+	int N = 0;
+	for(size_t i = 0 ; i < dims.size() ; ++i)
+		N += dims[i].first*dims[i].second;
+
+
+	// bounding box of the locations of the nodes, in the finest map
+	std::vector<int> top(N, rows), left(N, cols), bottom(N, -1), right(N, -1);
+	for(int r = 0 ; r < N ; ++r) {
+		int nla = static_cast<int>(lx.at<double>(r, 1));
+		for(int iii = 0 ; iii < nla ; ++iii) {
+			int a = static_cast<int>(lx.at<double>(r, 2+iii));
+			top[r]    = std::min(top[r], a / cols);
+			bottom[r] = std::max(bottom[r], a / cols);
+			left[r]   = std::min(left[r], a % cols);
+			right[r]  = std::max(right[r], a % cols);
+		}
+	}
+
+	// nodes of each level by the corner of their box, and the largest box of the level
+	std::vector< std::vector< std::vector<int> > > corners(dims.size(), std::vector< std::vector<int> >(rows*cols));
+	std::vector<int> height(dims.size(), 1), width(dims.size(), 1);
+
+	int offset = 0;
+	for(size_t l = 0 ; l < dims.size() ; ++l) {
+		int size = dims[l].first*dims[l].second;
+		for(int c = offset ; c < offset + size ; ++c) {
+			if(bottom[c] < 0) continue;
+
+			corners[l][top[c]*cols + left[c]].push_back(c);
+			height[l] = std::max(height[l], bottom[c] - top[c] + 1);
+			width[l]  = std::max(width[l], right[c] - left[c] + 1);
+		}
+		offset += size;
+	}
+
+
+	std::vector<int> rowPtr(1, 0);
+	std::vector<int> colIdx;
+	std::vector<double> distances;
+
+	std::vector<int> windowRows, windowCols;
+	std::vector< std::pair<int, double> > edges;
+
+	for(int r = 0 ; r < N ; ++r) {
+		int nla = static_cast<int>(lx.at<double>(r, 1));
+		edges.clear();
+
+		for(size_t l = 0 ; l < dims.size() && nla > 0 ; ++l) {
+			windowRange(top[r] - reach - (height[l]-1), bottom[r] + reach, rows, cyclic, windowRows);
+			windowRange(left[r] - reach - (width[l]-1), right[r] + reach, cols, cyclic, windowCols);
+
+			for(size_t i = 0 ; i < windowRows.size() ; ++i) {
+				for(size_t j = 0 ; j < windowCols.size() ; ++j) {
+					const std::vector<int> &nodes = corners[l][windowRows[i]*cols + windowCols[j]];
+
+					for(size_t n = 0 ; n < nodes.size() ; ++n) {
+						int c = nodes[n];
+						int nlb = static_cast<int>(lx.at<double>(c, 1));
+
+						// using location matrix, determine locations of the two nodes
+						double mean_dist = 0;
+						for(int iii = 0 ; iii < nla ; ++iii) {
+							for(int jjj = 0 ; jjj < nlb ; ++jjj) {
+								mean_dist += nodedistance(dims[0], cyclic_type, static_cast<int>(lx.at<double>(r, 2+iii)), static_cast<int>(lx.at<double>(c, 2+jjj)));
+							}
+						}
+
+						mean_dist /= (nla*nlb);
+
+						if(mean_dist <= maxDistance) {
+							edges.push_back(std::make_pair(c, mean_dist));
+						}
+					}
+				}
+			}
+		}
+
+		// the columns of a row are stored in increasing order
+		std::sort(edges.begin(), edges.end());
+		for(size_t e = 0 ; e < edges.size() ; ++e) {
+			colIdx.push_back(edges[e].first);
+			distances.push_back(edges[e].second);
+		}
+
+		rowPtr.push_back(static_cast<int>(colIdx.size()));
+	}
+
+	graph.assign(rowPtr, colIdx, distances);
+}
+
+
 
 void GBVS::arrangeLinear(const std::vector<cv::Mat> &apyr, const std::vector< std::pair<int, int> > &dims, std::vector<double> &o_datas) const {
 	int sumDim = 0;
@@ -938,6 +1153,102 @@ void GBVS::principalEigenvectorRaw(const cv::Mat& markovA, float tol, std::vecto
 
 
 
+void GBVS::assignWeightsSparse(const std::vector<double>& AL, const SparseGraph& graph, const std::vector<double>& dw, std::vector<double> &mm, int algtype) const {
+
+	for(int r = 0 ; r < static_cast<int>(AL.size()) ; ++r) {
+		for(int k = graph.rowPtr[r] ; k < graph.rowPtr[r+1] ; ++k) {
+			int c = graph.colIdx[k];
+
+			if(algtype == 1) {
+				mm[k] = dw[k] * AL[r];
+			} else if(algtype == 2) {
+				mm[k] = dw[k] * std::abs( AL[r] - AL[c] );
+			} else if(algtype == 3) {
+				mm[k] = dw[k] * std::abs( std::log( AL[r]/AL[c] ) );
+			} else if(algtype == 4) {
+				mm[k] = dw[k] * 1.f / (std::abs( AL[r] - AL[c] )+1e-12);
+			}
+		}
+	}
+}
+
+
+
+// each column sums to 1
+void GBVS::columnNormalizeSparse(const SparseGraph& graph, std::vector<double> &mm) const {
+	std::vector<double> sums(graph.rowPtr.size()-1, 0.f);
+
+	for(size_t k = 0 ; k < mm.size() ; ++k) {
+		sums[graph.colIdx[k]] += mm[k];
+	}
+
+	for(size_t c = 0 ; c < sums.size() ; ++c) {
+		if(std::abs(sums[c]) < 0.00000000001) {
+			sums[c] = 0.00000000001;
+		}
+	}
+
+	for(size_t k = 0 ; k < mm.size() ; ++k) {
+		mm[k] /= sums[graph.colIdx[k]];
+	}
+}
+
+
+
+// computes the principal eigenvector of a sparse markov matrix, same iterations as principalEigenvectorRaw
+void GBVS::principalEigenvectorSparse(const SparseGraph& graph, const std::vector<double>& markovA, float tol, std::vector<double>& AL, int &iteri) const {
+	int D = static_cast<int>(graph.rowPtr.size()) - 1;
+	double df = 1.0f;
+
+	std::vector<double> v(D, 1.f/D);
+	std::vector<double> oldv = v;
+	std::vector<double> oldoldv = v;
+
+	iteri = 0;
+
+	while(df > tol && iteri < 10000 ) {
+
+		// oldoldv <- oldv <- v, and v is then overwritten by markovA * oldv
+		oldoldv.swap(oldv);
+		oldv.swap(v);
+
+		for(int r = 0 ; r < D ; ++r) {
+			double acc = 0;
+			for(int k = graph.rowPtr[r] ; k < graph.rowPtr[r+1] ; ++k) {
+				acc += markovA[k] * oldv[graph.colIdx[k]];
+			}
+			v[r] = acc;
+		}
+
+		// principalEigenvectorRaw iterates over the columns of v (a column vector), so only the first node
+		// drives the stopping criterion. Keep the same rule so both graph modes give the same maps.
+		double diff = oldv[0] - v[0];
+		df = std::sqrt(diff*diff);
+		double sum = v[0];
+
+		++iteri;
+
+		if( sum >= 0 )
+			continue;
+		else {
+			v = oldoldv; 
+			break;
+		}
+	}
+
+	double sum = 0;
+	for(int i = 0 ; i < D ; ++i) {
+		sum += v[i];
+	}
+
+	for(int i = 0 ; i < D ; ++i) {
+		AL[i] = v[i] / sum;
+	}
+
+}
+
+
+
 float GBVS::sparseness(const cv::Mat& markovA) const {
 	float notNull = 0;
 	for(int i = 0 ; i < markovA.rows ; ++i) {
@@ -970,9 +1281,107 @@ void GBVS::sumOverScales(std::vector<double> &v, const cv::Mat &lx, int N, std::
 // core function 
 
 
+// edge weights in the precision of the markov chains
+static inline const double *denseWeights 	(const EdgeWeights &w, double) 	{ return w.dw.ptr<double>(); 	}
+static inline const float  *denseWeights 	(const EdgeWeights &w, float) 	{ return w.dwf.ptr<float>(); 	}
+static inline const double *sparseWeights 	(const EdgeWeights &w, double) 	{ return &w.sparse[0]; 			}
+static inline const float  *sparseWeights 	(const EdgeWeights &w, float) 	{ return &w.sparsef[0]; 		}
+
 
 
-cv::Mat GBVS::graphsalapply(const cv::Mat &A, const Frame& frame, float sigma_frac, int num_iters, int algtype, float tol) const {
+template<typename T>
+static void solveChain(const MarkovChain<T> &markov, int solver, float tol, std::vector<T> &AL, int &iteri, bool warmStart) {
+	if(solver == 2)
+		principalEigenvectorExtrapolated(markov, tol, AL, iteri, warmStart);
+	else
+		principalEigenvector(markov, tol, AL, iteri, warmStart);
+}
+
+
+
+// activation of the nodes AL with the matrix-free engine, the markov chains use the precision T.
+// iterations receives the number of products by the markov matrix.
+template<typename T>
+static void markovActivation(const Frame& frame, const EdgeWeights &weights, std::vector<double> &AL, int num_iters, int algtype, float tol, int solver, bool warmStart, int &iterations) {
+	std::vector<T> ALt(AL.begin(), AL.end());
+
+	iterations = 0;
+	for(int iter = 0 ; iter < num_iters ; ++iter) {
+		int iteri = 0;
+
+		if(!frame.sparse.rowPtr.empty()) {
+			MarkovChain<T> markov(frame.sparse, sparseWeights(weights, T()), ALt, algtype);
+			solveChain(markov, solver, tol, ALt, iteri, warmStart);
+		} else {
+			MarkovChain<T> markov(denseWeights(weights, T()), weights.dw.cols, ALt, algtype);
+			solveChain(markov, solver, tol, ALt, iteri, warmStart);
+		}
+
+		iter += iteri;
+		iterations += iteri;
+	}
+
+	std::copy(ALt.begin(), ALt.end(), AL.begin());
+}
+
+
+
+// same as markovActivation with the power iterations, for several maps solved together (see BatchedMarkovChain)
+template<typename T>
+static void markovActivationBatch(const Frame& frame, const EdgeWeights &weights, std::vector< std::vector<double> > &AL, int num_iters, int algtype, float tol, bool warmStart, std::vector<int> &iterations) {
+	size_t K = AL.size();
+
+	std::vector< std::vector<T> > ALt(K);
+	for(size_t k = 0 ; k < K ; ++k) {
+		ALt[k].assign(AL[k].begin(), AL[k].end());
+	}
+
+	// same outer iterations as graphsalapply, for each map
+	std::vector<int> iter(K, 0);
+	iterations.assign(K, 0);
+
+	while(true) {
+		std::vector< std::vector<T>* > pending;
+		for(size_t k = 0 ; k < K ; ++k) {
+			if(iter[k] < num_iters)
+				pending.push_back(&ALt[k]);
+		}
+
+		if(pending.empty())
+			break;
+
+		std::vector<int> iteri;
+		if(!frame.sparse.rowPtr.empty()) {
+			BatchedMarkovChain<T> markov(frame.sparse, sparseWeights(weights, T()), pending, algtype);
+			principalEigenvectors(markov, tol, pending, iteri, warmStart);
+		} else {
+			BatchedMarkovChain<T> markov(denseWeights(weights, T()), weights.dw.cols, pending, algtype);
+			principalEigenvectors(markov, tol, pending, iteri, warmStart);
+		}
+
+		for(size_t k = 0, j = 0 ; k < K ; ++k) {
+			if(iter[k] < num_iters) {
+				iter[k] += 1 + iteri[j];
+				iterations[k] += iteri[j];
+				++j;
+			}
+		}
+	}
+
+	for(size_t k = 0 ; k < K ; ++k) {
+		std::copy(ALt[k].begin(), ALt[k].end(), AL[k].begin());
+	}
+}
+
+
+
+
+
+cv::Mat GBVS::graphsalapply(const cv::Mat &A, const Frame& frame, float sigma_frac, int num_iters, int algtype, float tol, int *iterations) const {
+	int products = 0;
+	if(iterations != NULL)
+		*iterations = 0;
+
 	if(algtype == 4) {
 		cv::Mat result;
 		cv::pow(A, 1.5, result);
@@ -981,50 +1390,97 @@ cv::Mat GBVS::graphsalapply(const cv::Mat &A, const Frame& frame, float sigma_fr
 
 	const cv::Mat &lx = frame.lx;
 
-	// form a multiresolution pyramid of feature maps according to multilevels
-	std::vector<cv::Mat> apyr;
-	std::vector< std::pair<int, int> > dims;
-	formMapPyramid(A, frame.multilevels, apyr, dims);
+	double sig = sigma_frac * static_cast<double>(frame.dims[0].first + frame.dims[0].second)/2.f;
+
+	// assign a linear index to each node
+	std::vector<double> AL;
+	graphsalnodes(A, frame, AL);
+
+
+	//get a weight matrix between nodes based on distance matrix. It is computed once per frame and sigma.
+	bool single = singlePrecision && graphEngine == 2;
+	boost::shared_ptr<const EdgeWeights> weights = edgeWeights(frame, sig, single);
+
+	if(graphEngine == 2) {
+
+		// the markov matrix is never stored: the weights are combined with AL on the fly
+		if(single)
+			markovActivation<float>(frame, *weights, AL, num_iters, algtype, tol, eigenSolver, warmStart, products);
+		else
+			markovActivation<double>(frame, *weights, AL, num_iters, algtype, tol, eigenSolver, warmStart, products);
+
+	} else if(!frame.sparse.rowPtr.empty()) {
+		const SparseGraph &graph = frame.sparse;
+		const std::vector<double> &dw = weights->sparse;
+
+		// state transition matrix between nodes, same sparsity as the graph
+		std::vector<double> mm(graph.d.size());
+
+		for(int iter = 0 ; iter < num_iters ; ++iter) {
+			assignWeightsSparse( AL , graph, dw , mm , algtype );
+			columnNormalizeSparse(graph, mm);
 
+			int iteri = 0;
+			principalEigenvectorSparse(graph, mm, tol, AL, iteri); 
 
-	//get a weight matrix between nodes based on distance matrix
-	double sig = sigma_frac * static_cast<double>(A.cols + A.rows)/2.f;
-	cv::Mat dw(frame.d.rows, frame.d.cols, CV_64FC1, cv::Scalar(0.f)); 
-	for(int i = 0 ; i < frame.d.rows ; ++i) {
-		for(int j = 0 ; j < frame.d.cols ; ++j) {
-			dw.at<double>(i,j) = std::exp( -1 * frame.d.at<double>(i,j) / (2 * sig*sig));
+			iter += iteri;
+			products += iteri;
+		}
+
+	} else {
+		const cv::Mat &dw = weights->dw;
+
+		// create the state transition matrix between nodes
+		cv::Mat mm(lx.rows, lx.rows, CV_64FC1, cv::Scalar(0.f)); 
+
+		for(int iter = 0 ; iter < num_iters ; ++iter) {
+
+			// assign edge weights based on distances between nodes and algtype
+			assignWeights( AL , dw , mm , algtype );
+
+			// make it a markov matrix (so each column sums to 1)
+			columnNormalize(mm);
+
+			int iteri = 0;
+			principalEigenvectorRaw(mm, tol, AL, iteri); 
+
+			iter += iteri;
+			products += iteri;
 		}
 	}
 
-	// assign a linear index to each node
-	std::vector<double> AL;
-	arrangeLinear(apyr , dims, AL);
+	if(iterations != NULL)
+		*iterations = products;
 
+	cv::Mat result;
+	graphsalmap(AL, frame, A.rows, A.cols, result);
+	return result;
+}
 
-	// create the state transition matrix between nodes
-	cv::Mat mm(lx.rows, lx.rows, CV_64FC1, cv::Scalar(0.f)); 
 
-	for(int iter = 0 ; iter < num_iters ; ++iter) {
 
-		// assign edge weights based on distances between nodes and algtype
-		assignWeights( AL , dw , mm , algtype );
+// node values of a map: form a multiresolution pyramid of feature maps according to multilevels, 
+// and assign a linear index to each node
+void GBVS::graphsalnodes(const cv::Mat &A, const Frame& frame, std::vector<double> &AL) const {
+	std::vector<cv::Mat> apyr;
+	std::vector< std::pair<int, int> > dims;
+	formMapPyramid(A, frame.multilevels, apyr, dims);
 
-		// make it a markov matrix (so each column sums to 1)
-		columnNormalize(mm);
+	arrangeLinear(apyr , dims, AL);
+}
 
-		int iteri = 0;
-		principalEigenvectorRaw(mm, tol, AL, iteri); 
 
-		iter += iteri;
-	}
+
+// map from node values. result is written in place if it already has the size of the map.
+void GBVS::graphsalmap(std::vector<double> &AL, const Frame& frame, int rows, int cols, cv::Mat &result) const {
 
 	// collapse multiresolution representation back onto one scale
 	std::vector<double> vo;
-	sumOverScales(AL, lx, A.cols*A.rows, vo);
+	sumOverScales(AL, frame.lx, cols*rows, vo);
 
 	
 	// arrange the nodes back into a rectangular map
-	cv::Mat result(A.rows, A.cols, CV_64FC1, cv::Scalar(0.f));
+	result.create(rows, cols, CV_64FC1);
 	int curindex = 0;
 	for(int jj = 0 ; jj < result.cols ; ++jj) {
 		for(int ii = 0 ; ii < result.rows ; ++ii) {
@@ -1032,8 +1488,49 @@ cv::Mat GBVS::graphsalapply(const cv::Mat &A, const Frame& frame, float sigma_fr
 			++curindex;
 		}
 	}
+}
 
-	return result;
+
+
+// graphsalapply on several maps of the same size, with the matrix-free engine. The power iterations of 
+// all the maps run together (see BatchedMarkovChain), the results are the same as with graphsalapply.
+void GBVS::graphsalapplyBatch(const std::vector<cv::Mat*> &maps, const Frame& frame, float sigma_frac, int num_iters, int algtype, float tol, std::vector<int> *iterations) const {
+	if(maps.empty()) return;
+
+	std::vector<int> products(maps.size(), 0);
+	if(iterations != NULL)
+		*iterations = products;
+
+	if(algtype == 4) {
+		for(size_t k = 0 ; k < maps.size() ; ++k) {
+			cv::pow(*maps[k], 1.5, *maps[k]);
+		}
+		return;
+	}
+
+	const int rows = maps[0]->rows;
+	const int cols = maps[0]->cols;
+	double sig = sigma_frac * static_cast<double>(frame.dims[0].first + frame.dims[0].second)/2.f;
+
+	size_t K = maps.size();
+	std::vector< std::vector<double> > AL(K);
+	for(size_t k = 0 ; k < K ; ++k) {
+		graphsalnodes(*maps[k], frame, AL[k]);
+	}
+
+	boost::shared_ptr<const EdgeWeights> weights = edgeWeights(frame, sig, singlePrecision);
+
+	if(singlePrecision)
+		markovActivationBatch<float>(frame, *weights, AL, num_iters, algtype, tol, warmStart, products);
+	else
+		markovActivationBatch<double>(frame, *weights, AL, num_iters, algtype, tol, warmStart, products);
+
+	if(iterations != NULL)
+		*iterations = products;
+
+	for(size_t k = 0 ; k < K ; ++k) {
+		graphsalmap(AL[k], frame, rows, cols, *maps[k]);
+	}
 }
 
 
@@ -1043,6 +1540,63 @@ cv::Mat GBVS::graphsalapply(const cv::Mat &A, const Frame& frame, float sigma_fr
 
 
 
+static void singleWeights(EdgeWeights &weights) {
+	weights.sparsef.assign(weights.sparse.begin(), weights.sparse.end());
+	if(!weights.dw.empty())
+		weights.dw.convertTo(weights.dwf, CV_32FC1);
+}
+
+
+// the weights only depend on the frame and sigma, which are the same for all the maps of a run:
+// compute them once and keep them with the frame. The single precision copy is added to the cached
+// weights the first time it is requested.
+boost::shared_ptr<const EdgeWeights> GBVS::edgeWeights(const Frame& frame, double sig, bool single) const {
+
+	boost::mutex::scoped_lock lock(frame.weightsMutex);
+
+	std::map< double, boost::shared_ptr<const EdgeWeights> >::const_iterator it = frame.weights.find(sig);
+	if(it != frame.weights.end()) {
+		const EdgeWeights &cached = *it->second;
+		if(!single || (cached.dwf.size() == cached.dw.size() && cached.sparsef.size() == cached.sparse.size()))
+			return it->second;
+
+		// the weights may be in use by other threads: they are copied, and the copy is completed
+		boost::shared_ptr<EdgeWeights> weights(new EdgeWeights(cached));
+		singleWeights(*weights);
+
+		frame.weights[sig] = weights;
+		return weights;
+	}
+
+	boost::shared_ptr<EdgeWeights> weights(new EdgeWeights());
+
+	if(!frame.sparse.rowPtr.empty()) {
+		// the edges stored for a larger sigma are dropped if they fall below the cutoff
+		const ArrayView<double> &d = frame.sparse.d;
+		weights->sparse.resize(d.size());
+		for(size_t k = 0 ; k < d.size() ; ++k) {
+			double w = std::exp( -1 * d[k] / (2 * sig*sig));
+			weights->sparse[k] = (w >= sparseCutoff) ? w : 0;
+		}
+
+	} else {
+		weights->dw = cv::Mat(frame.d.rows, frame.d.cols, CV_64FC1, cv::Scalar(0.f));
+		for(int i = 0 ; i < frame.d.rows ; ++i) {
+			for(int j = 0 ; j < frame.d.cols ; ++j) {
+				weights->dw.at<double>(i,j) = std::exp( -1 * frame.d.at<double>(i,j) / (2 * sig*sig));
+			}
+		}
+	}
+
+	if(single) {
+		singleWeights(*weights);
+	}
+
+	frame.weights[sig] = weights;
+	return weights;
+}
+
+
 // ==============================================================================================================================
 // Features related functions
 
@@ -1058,6 +1612,8 @@ void GBVS::makeGaborFilters() {
 
 		gaborFilters.push_back(g);
 	}
+
+	gaborBank.set(gaborFilters);
 }
 
 
@@ -1136,29 +1692,21 @@ cv::Mat GBVS::makeGaborFilterGBVS(float angle, float phase, float stddev, float
 
 
 cv::Mat GBVS::subsample(const cv::Mat& img) const {
-	int w, h, wr, hr;
-	w = img.cols;
-	h = img.rows;
-	wr = w / 2; if ( wr == 0 ) wr = 1;
-	hr = h / 2; if ( hr == 0 ) hr = 1;
+	if ( (img.cols > 10) && (img.rows > 10) ) {
+		cv::Mat dec;
+		lowPass6Dec(img, dec);
+		return dec;
+	} else {
+		return img;
+	}
 
-	cv::Mat decx (wr, h, CV_64FC1, 1);	// /!\ Do not forget to transpose the coordinate of the matrix.... 
-	cv::Mat decxy(wr, hr, CV_64FC1, 1);
+}
 
-	if ( (w > 10) && (h > 10) ) {  
-		// we need to transpose the input data as OpenCV and MATLAB do not use the same order for data
-		// Indeed, MATLAB pointer gives data by column, OpenCV gives it by row
-		// And I copy/pasted the original MEX code... 
-		cv::Mat tr = transpose(img);
 
-		lowPass6xDecX(reinterpret_cast<double*>(tr.data), reinterpret_cast<double*>(decx.data), w, h);
-		lowPass6yDecY(reinterpret_cast<double*>(decx.data), reinterpret_cast<double*>(decxy.data), wr, h);
 
-		return transpose(decxy);
-	} else {
-		return img;
-	}
 
+void GBVS::orientationEnergies(const cv::Mat& img, std::vector<cv::Mat> &energies) const {
+	gaborBank.apply(img, energies, orientationFilter);
 }
 
 
@@ -1237,50 +1785,26 @@ void GBVS::getFeatureMaps(const cv::Mat& img) {
 
 
 	// -----------------------------------------------------------------------------
-	// custom step. Do we use a CSF on the luminance? 
-	// replace max(R,G,B) by L from Luv and apply a CSF
-
-
-	if(useCSF)
-		imgi = applyCSF(img);
-
-
-	// -----------------------------------------------------------------------------
+	// The extraction runs as a small task graph on the pool: the pyramids are built in parallel, then
+	// each (channel, level) of the multi-level channels and each single-level channel is a task which
+	// produces its resized maps in its own slot. The features are assembled in the order of the channels.
 
+	Pyramids pyr;
 
-	std::vector<cv::Mat> imgL, imgR, imgG, imgB;
-	imgL.push_back(subsample(imgi));
-	imgR.push_back(subsample(imgr));
-	imgG.push_back(subsample(imgg));
-	imgB.push_back(subsample(imgb));
-
-	for(int i = 1 ; i < maxcomputelevel ; ++i) {
-
-		imgL.push_back(subsample(imgL.back()));
-
-
-		if(isColor) {
-			imgR.push_back(subsample(imgR.back()));
-			imgG.push_back(subsample(imgG.back()));
-			imgB.push_back(subsample(imgB.back()));
-		} else {
-			imgR.push_back(cv::Mat());
-			imgG.push_back(cv::Mat());
-			imgB.push_back(cv::Mat());
-		}
+	std::vector<ThreadPool::Task> tasks;
+	tasks.push_back(boost::bind(&GBVS::getLuminancePyramidJob, this, boost::cref(img), boost::cref(imgi), boost::ref(pyr)));
+	if(isColor) {
+		tasks.push_back(boost::bind(&GBVS::getPyramidJob, this, boost::cref(imgr), boost::ref(pyr.R), maxcomputelevel));
+		tasks.push_back(boost::bind(&GBVS::getPyramidJob, this, boost::cref(imgg), boost::ref(pyr.G), maxcomputelevel));
+		tasks.push_back(boost::bind(&GBVS::getPyramidJob, this, boost::cref(imgb), boost::ref(pyr.B), maxcomputelevel));
+	}
 
-		if(imgL.back().cols < 3 || imgL.back().rows < 3) {
-			std::cerr << "[I] reached minimum size at level " << i << "cutting off additional levels\n";
-			std::vector<int> ll;
-			for(int j = 0 ; j < i+1 ; ++j) {
-				ll.push_back(levels.at(i));
-			}
+	ThreadPool::global().invoke(tasks);
 
-			levels = ll;
-			maxcomputelevel = i;
-			break;
-		}
-	}
+	// the luminance pyramid may have been cut off
+	pyr.R.resize(pyr.L.size());
+	pyr.G.resize(pyr.L.size());
+	pyr.B.resize(pyr.L.size());
 
 	// //TODO: full model needs to support motion!
 
@@ -1288,9 +1812,15 @@ void GBVS::getFeatureMaps(const cv::Mat& img) {
 	// -----------------------------------------------------------------------------
 	// STEP 2 : compute feature maps
 
-	int channelProcessed = 0;
+	std::vector<Feature> 								channelFeatures(channels.length());
+	std::vector<char> 									produced(channels.length(), 0);
+	std::vector< std::vector< std::list<FeatureMap> > > levelMaps(channels.length(), std::vector< std::list<FeatureMap> >(levels.size()));
+
+	tasks.clear();
 	for(size_t i = 0 ; i < channels.length() ; ++i) {
 
+		Feature &f = channelFeatures[i];
+
 		switch(channels[i]) {
 			case 'D':
 				if(!isColor) {
@@ -1298,350 +1828,372 @@ void GBVS::getFeatureMaps(const cv::Mat& img) {
 					break;
 				}
 
-				{
-					Feature f;
-					f.description = "DKL Luminosity Channel";
-					f.weight = dklcolorWeight;
-					f.channel = channelProcessed;
-
-					for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
-						cv::Mat KL, KC1, KC2;
-
-						rgb2dkl(imgR[levels[lev]-1], imgG[levels[lev]-1], imgB[levels[lev]-1], KL, KC1, KC2);
-
-						FeatureMap fm1;
-						fm1.type  = 0;
-						fm1.level = lev; 
-						fm1.channel = channelProcessed;
-						cv::resize(KL, fm1.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-						
-						
-						FeatureMap fm2;
-						fm2.type  = 1;
-						fm2.level = lev; 
-						fm2.channel = channelProcessed;
-						cv::resize(KC1, fm2.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-
-
-						FeatureMap fm3;
-						fm3.type  = 2;
-						fm3.level = lev; 
-						fm3.channel = channelProcessed;
-						cv::resize(KC2, fm3.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-
-						
-						f.maps.push_back(fm1);
-						f.maps.push_back(fm2);
-						f.maps.push_back(fm3);
-					}
+				f.description = "DKL Luminosity Channel";
+				f.weight = dklcolorWeight;
+				produced[i] = 1;
 
-					features.push_back(f);
+				tasks.push_back(boost::bind(&GBVS::getDKLJob, this, boost::cref(pyr), boost::ref(f)));
+				break;
+
+			case 'C':
+				if(!isColor) {
+					std::cerr << "[I] cannot compute color feature on B&W image. Skip that feature." << std::endl;
+					break;
 				}
 
-				++channelProcessed;
+				// fall through: multi-level channel
+
+			case 'I':
+			case 'O':
+			case 'R':
+				switch(channels[i]) {
+					case 'C': f.description = "Color features"; 			f.weight = colorWeight; 		break;
+					case 'I': f.description = "Intensity"; 					f.weight = intensityWeight; 	break;
+					case 'O': f.description = "Gabor filtering"; 			f.weight = orientationWeight; 	break;
+					case 'R': f.description = "Contrast feature"; 			f.weight = contrastWeight; 		break;
+				}
+				produced[i] = 1;
 
+				for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
+					tasks.push_back(boost::bind(&GBVS::getChannelLevelJob, this, channels[i], lev, boost::cref(pyr), boost::ref(levelMaps[i][lev])));
+				}
 				break;
 
-			case 'I':
+			case 'P':
+			case 'F':
+			case 'B':
+			case 'S':
+				tasks.push_back(boost::bind(&GBVS::getChannelJob, this, channels[i], boost::cref(img), boost::cref(pyr), boost::ref(f), boost::ref(produced[i])));
+				break;
+
+			default:
+
+				break;
+		}
+	}
+
+	ThreadPool::global().invoke(tasks);
 
-				{
-					Feature f;
-					f.description = "Intensity";
-					f.weight = intensityWeight;
-					f.channel = channelProcessed;
 
-					for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
-						FeatureMap fm1;
-						fm1.type  = 0;
-						fm1.level = lev; 
-						fm1.channel = channelProcessed;
+	int channelProcessed = 0;
+	for(size_t i = 0 ; i < channels.length() ; ++i) {
+		if(!produced[i])
+			continue;
+
+		Feature &f = channelFeatures[i];
+		for(size_t lev = 0 ; lev < levelMaps[i].size() ; ++lev) {
+			f.maps.splice(f.maps.end(), levelMaps[i][lev]);
+		}
 
-						cv::resize(imgL[levels[lev]-1], fm1.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-						
-						f.maps.push_back(fm1);
+		f.channel = channelProcessed;
+		for(std::list<FeatureMap>::iterator it = f.maps.begin() ; it != f.maps.end() ; ++it) {
+			it->channel = channelProcessed;
+		}
 
-						
+		features.push_back(f);
+		++channelProcessed;
+	}
+}
 
-					}
 
-					features.push_back(f);
-				}
-				
-				++channelProcessed;
 
-				break;
+// custom step. Do we use a CSF on the luminance? Replace max(R,G,B) by L from Luv and apply a CSF. 
+// The pyramid is pruned if its levels get too small.
+void GBVS::getLuminancePyramidJob(const cv::Mat& img, const cv::Mat& imgi, Pyramids &pyr) {
 
-			case 'O':
+	if(useCSF)
+		pyr.imgi = applyCSF(img);
+	else
+		pyr.imgi = imgi;
 
-				{
-					Feature f;
-					f.description = "Gabor filtering";
-					f.weight = orientationWeight;
-					f.channel = channelProcessed;
+	std::vector<cv::Mat> &imgL = pyr.L;
+	imgL.push_back(subsample(pyr.imgi));
 
-					for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
+	for(int i = 1 ; i < maxcomputelevel ; ++i) {
 
-							
-						for(int o = 0 ; o < static_cast<int>(gaborFilters.size()) ; ++ o) {
-							FeatureMap fm;
-							fm.type  = o;
-							fm.level = lev;
-							fm.channel = channelProcessed;
+		imgL.push_back(subsample(imgL.back()));
 
-							cv::Mat f0, f90;
-							cv::filter2D(imgL[levels[lev]-1], f0, CV_64F,  gaborFilters[o].g0,  cv::Point(-1, -1), 0, cv::BORDER_DEFAULT );
-							cv::filter2D(imgL[levels[lev]-1], f90, CV_64F, gaborFilters[o].g90, cv::Point(-1, -1), 0, cv::BORDER_DEFAULT );
+		if(imgL.back().cols < 3 || imgL.back().rows < 3) {
+			std::cerr << "[I] reached minimum size at level " << i << "cutting off additional levels\n";
+			std::vector<int> ll;
+			for(int j = 0 ; j < i+1 ; ++j) {
+				ll.push_back(levels.at(i));
+			}
 
-							cv::Mat map = cv::abs(f0) + cv::abs(f90);
+			levels = ll;
+			maxcomputelevel = i;
+			break;
+		}
+	}
+}
 
 
-							attenuateBordersGBVS(map, 13);
+void GBVS::getPyramidJob(const cv::Mat& img, std::vector<cv::Mat> &pyramid, int depth) const {
+	pyramid.push_back(subsample(img));
 
+	for(int i = 1 ; i < depth ; ++i) {
+		pyramid.push_back(subsample(pyramid.back()));
+	}
+}
 
-							cv::resize(map, fm.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-							
-							f.maps.push_back(fm);
-						}
-					}
 
-					features.push_back(f);
-				}
 
-				++channelProcessed;
+// maps of one level of the channels I, O, R and C
+void GBVS::getChannelLevelJob(char channel, int lev, const Pyramids &pyr, std::list<FeatureMap> &maps) const {
+	const cv::Mat &imgL = pyr.L[levels[lev]-1];
+	cv::Size mapSize(salmapmaxsize_v[1], salmapmaxsize_v[0]);
 
-				break;
+	switch(channel) {
+		case 'I':
+			{
+				FeatureMap fm1;
+				fm1.type  = 0;
+				fm1.level = lev; 
 
+				cv::resize(imgL, fm1.map, mapSize, 0, 0, cv::INTER_AREA);
+				
+				maps.push_back(fm1);
+			}
+			break;
 
-			case 'R':
+		case 'O':
+			{
+				// |g0 * img| + |g90 * img| of all the orientations of the level
+				std::vector<cv::Mat> energies;
+				orientationEnergies(imgL, energies);
+					
+				for(int o = 0 ; o < static_cast<int>(gaborFilters.size()) ; ++ o) {
+					FeatureMap fm;
+					fm.type  = o;
+					fm.level = lev;
 
-				{
-					Feature f;
-					f.description = "Contrast feature";
-					f.weight = contrastWeight;
-					f.channel = channelProcessed;
+					cv::Mat &map = energies[o];
 
-					for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
 
-						FeatureMap fm;
-						fm.type  = 0;
-						fm.level = lev;
-						fm.channel = channelProcessed;
+					attenuateBordersGBVS(map, 13);
 
-						cv::Mat contr = contrast(imgL[levels[lev]-1], static_cast<int>(std::round(imgL[levels[lev]-1].rows * contrastwidth)));
 
-						cv::resize(contr, fm.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-						f.maps.push_back(fm);
+					cv::resize(map, fm.map, mapSize, 0, 0, cv::INTER_AREA);
+					
+					maps.push_back(fm);
+				}
+			}
+			break;
 
-					}
+		case 'R':
+			{
+				FeatureMap fm;
+				fm.type  = 0;
+				fm.level = lev;
 
-					features.push_back(f);
+				cv::Mat contr = contrast(imgL, static_cast<int>(std::round(imgL.rows * contrastwidth)));
 
-				}
+				cv::resize(contr, fm.map, mapSize, 0, 0, cv::INTER_AREA);
+				maps.push_back(fm);
+			}
+			break;
 
-				++channelProcessed;
+		case 'C':
+			{
+				const cv::Mat &imgR = pyr.R[levels[lev]-1], &imgG = pyr.G[levels[lev]-1], &imgB = pyr.B[levels[lev]-1];
 
-				break;
+				// ------------------------------------------------------------------------------
+				// First feature... 
+				FeatureMap fm;
+				fm.type  = 0;
+				fm.level = lev;
 
+				cv::Mat diff(imgL.rows, imgL.cols, CV_64FC1, cv::Scalar(0.f)); 
 
-			case 'C':
-				if(!isColor) {
-					std::cerr << "[I] cannot compute color feature on B&W image. Skip that feature." << std::endl;
-					break;
+				for(int i = 0 ; i < diff.rows ; ++i) {
+					for(int j = 0 ; j < diff.rows ; ++j) {
+						diff.at<double>(i,j) = std::abs(imgB.at<double>(i,j) - std::min(imgR.at<double>(i,j), imgG.at<double>(i,j)));
+					}
 				}
 
-				{
-					Feature f;
-					f.description = "Color features";
-					f.weight = colorWeight;
-					f.channel = channelProcessed;
 
-					for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
+				diff = safeDivideGBVS(diff, imgL);
+				cv::resize(diff, fm.map, mapSize, 0, 0, cv::INTER_AREA);
+				maps.push_back(fm);
 
 
 
-						// ------------------------------------------------------------------------------
-						// First feature... 
-						FeatureMap fm;
-						fm.type  = 0;
-						fm.level = lev;
-						fm.channel = channelProcessed;
 
-						cv::Mat diff(imgL[levels[lev]-1].rows, imgL[levels[lev]-1].cols, CV_64FC1, cv::Scalar(0.f)); 
-
-						for(int i = 0 ; i < diff.rows ; ++i) {
-							for(int j = 0 ; j < diff.rows ; ++j) {
-								diff.at<double>(i,j) = std::abs(imgB[levels[lev]-1].at<double>(i,j) - std::min(imgR[levels[lev]-1].at<double>(i,j), imgG[levels[lev]-1].at<double>(i,j)));
-							}
-						}
+				// ------------------------------------------------------------------------------
+				// Second feature... 
+				FeatureMap fm2;
+				fm2.type  = 1;
+				fm2.level = lev;
 
+				for(int i = 0 ; i < diff.rows ; ++i) {
+					for(int j = 0 ; j < diff.rows ; ++j) {
+						diff.at<double>(i,j) = std::abs(imgR.at<double>(i,j) - imgG.at<double>(i,j));
+					}
+				}
 
-						diff = safeDivideGBVS(diff, imgL[levels[lev]-1]);
-						cv::resize(diff, fm.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-						f.maps.push_back(fm);
 
+				diff = safeDivideGBVS(diff, imgL);
+				cv::resize(diff, fm2.map, mapSize, 0, 0, cv::INTER_AREA);
+				
 
+				maps.push_back(fm2);
+			}
+			break;
+	}
+}
 
 
-						// ------------------------------------------------------------------------------
-						// Second feature... 
-						FeatureMap fm2;
-						fm2.type  = 1;
-						fm2.level = lev;
-						fm2.channel = channelProcessed;
 
-						for(int i = 0 ; i < diff.rows ; ++i) {
-							for(int j = 0 ; j < diff.rows ; ++j) {
-								diff.at<double>(i,j) = std::abs(imgR[levels[lev]-1].at<double>(i,j) - imgG[levels[lev]-1].at<double>(i,j));
-							}
-						}
+// 'D' channel: all the requested levels are converted in one pass, in a single buffer holding the three 
+// DKL planes of each pyramid level, and then resized into the feature maps.
+void GBVS::getDKLJob(const Pyramids &pyr, Feature &f) const {
+	cv::Size mapSize(salmapmaxsize_v[1], salmapmaxsize_v[0]);
 
+	// offset of the planes of each pyramid level in the buffer (a level may be requested several times)
+	std::vector<int> offset(pyr.L.size(), -1);
+	int total = 0;
+	for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
+		int p = levels[lev]-1;
+		if(offset[p] < 0) {
+			offset[p] = total;
+			total += 3 * static_cast<int>(pyr.R[p].total());
+		}
+	}
 
-						diff = safeDivideGBVS(diff, imgL[levels[lev]-1]);
-						cv::resize(diff, fm2.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-						
+	cv::Mat buffer(1, std::max(1, total), CV_64FC1);
+	double *data = buffer.ptr<double>(0);
 
-						f.maps.push_back(fm2);
+	std::vector<cv::Mat> planes(3 * pyr.L.size());
+	for(size_t p = 0 ; p < pyr.L.size() ; ++p) {
+		if(offset[p] < 0)
+			continue;
 
-					}
+		int area = static_cast<int>(pyr.R[p].total());
+		for(int k = 0 ; k < 3 ; ++k) {
+			planes[3*p+k] = cv::Mat(pyr.R[p].rows, pyr.R[p].cols, CV_64FC1, data + offset[p] + k * area);
+		}
 
-					features.push_back(f);
+		DKLTable::instance().convert(pyr.R[p], pyr.G[p], pyr.B[p], planes[3*p], planes[3*p+1], planes[3*p+2]);
+	}
 
-				}
+	for (int lev = 0 ; lev < static_cast<int>(levels.size()) ; ++lev) {
+		int p = levels[lev]-1;
 
+		for(int k = 0 ; k < 3 ; ++k) {
+			FeatureMap fm;
+			fm.type  = k;
+			fm.level = lev; 
+			cv::resize(planes[3*p+k], fm.map, mapSize, 0, 0, cv::INTER_AREA);
+			f.maps.push_back(fm);
+		}
+	}
+}
 
-				++channelProcessed;
 
-				break;
 
+// single level channels P, F, B and S. produced is set if the channel gives a feature.
+void GBVS::getChannelJob(char channel, const cv::Mat& img, const Pyramids &pyr, Feature &f, char &produced) {
+	cv::Size mapSize(salmapmaxsize_v[1], salmapmaxsize_v[0]);
 
-			case 'P':
+	switch(channel) {
+		case 'P':
 
 #ifdef WITH_LINPER
-				{
-					Feature f;
-					f.description = "Linear perspective";
-					f.channel = channelProcessed;
-
-					std::vector<double> reliability(4);
-					std::vector<cv::Mat> outputs(4);
-					boost::thread_group g;
-					for(size_t i = 0 ; i < outputs.size() ; ++i) {
-						g.create_thread(boost::bind(&GBVS::getPerspectiveFeatureJob, this, boost::ref(img), boost::ref(outputs[i]), &reliability[i]));
-					}
-					g.join_all();
+			{
+				f.description = "Linear perspective";
 
-					for(size_t i = 1 ; i < outputs.size() ; ++i) {
-						outputs[0] += outputs[i];
-						reliability[0] += reliability[i];
-					}
-					outputs[0] /= static_cast<double>(outputs.size());
-					reliability[0] /= static_cast<double>(outputs.size());
+				std::vector<double> reliability(4);
+				std::vector<cv::Mat> outputs(4);
+				ThreadPool::global().parallelFor(static_cast<int>(outputs.size()), boost::bind(&GBVS::getPerspectiveFeatureJob, this, boost::cref(img), boost::ref(outputs), boost::ref(reliability), _1));
 
-					FeatureMap fm;
-					fm.type  = 0;
-					fm.level = 0;
-					fm.channel = channelProcessed;
+				for(size_t i = 1 ; i < outputs.size() ; ++i) {
+					outputs[0] += outputs[i];
+					reliability[0] += reliability[i];
+				}
+				outputs[0] /= static_cast<double>(outputs.size());
+				reliability[0] /= static_cast<double>(outputs.size());
 
-					if(reliability[0] < 0.0015) {	// if the feature map does not contains much information, drop it.
-						fm.map = cv::Mat(cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), CV_64FC1, cv::Scalar(0.f));
-					} else {
-						cv::resize(outputs[0], fm.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-					}
+				FeatureMap fm;
+				fm.type  = 0;
+				fm.level = 0;
 
-					f.maps.push_back(fm);
-					if(reliability[0] >= 0.0038)
-						f.weight = std::min(100.f, std::max(0.f, static_cast<float>(-2.824f + 3.105f * exp(662.373f * reliability[0])))) / 30.f;
-					else
-						f.weight = std::min(100.f, std::max(0.f, static_cast<float>(-3.276f + 2.936f * exp(689.485f * reliability[0])))) / 70.f;
-						
-					features.push_back(f);
-					++channelProcessed;
+				if(reliability[0] < 0.0015) {	// if the feature map does not contains much information, drop it.
+					fm.map = cv::Mat(mapSize, CV_64FC1, cv::Scalar(0.f));
+				} else {
+					cv::resize(outputs[0], fm.map, mapSize, 0, 0, cv::INTER_AREA);
 				}
+
+				f.maps.push_back(fm);
+				if(reliability[0] >= 0.0038)
+					f.weight = std::min(100.f, std::max(0.f, static_cast<float>(-2.824f + 3.105f * exp(662.373f * reliability[0])))) / 30.f;
+				else
+					f.weight = std::min(100.f, std::max(0.f, static_cast<float>(-3.276f + 2.936f * exp(689.485f * reliability[0])))) / 70.f;
+					
+				produced = 1;
+			}
 #else
-					std::cerr << "[I] GBVS was not compiled with the Linear perspective module. Skipped." << std::endl;
+				std::cerr << "[I] GBVS was not compiled with the Linear perspective module. Skipped." << std::endl;
 
 #endif
-			break;
-
-
-			case 'F':
+		break;
 
-				{
-					Feature f;
-					f.description = "Face detector";
-					f.weight = faceFeatureWeight;
-					f.channel = channelProcessed;
 
-					cv::Mat featureMap = faceFeaturesDectection(imgi);
+		case 'F':
 
-					if(!featureMap.empty()) {
-						FeatureMap fm;
-						fm.type  = 0;
-						fm.level = 0;
-						fm.channel = channelProcessed;
+			{
+				f.description = "Face detector";
+				f.weight = faceFeatureWeight;
 
-						cv::resize(featureMap, fm.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-						f.maps.push_back(fm);
+				cv::Mat featureMap = faceFeaturesDectection(img);
 
+				if(!featureMap.empty()) {
+					FeatureMap fm;
+					fm.type  = 0;
+					fm.level = 0;
 
-						features.push_back(f);
-						++channelProcessed;
-					}
+					cv::resize(featureMap, fm.map, mapSize, 0, 0, cv::INTER_AREA);
+					f.maps.push_back(fm);
 
+					produced = 1;
 				}
 
-			break;
-
-
-			case 'B':
+			}
 
-				{
-					Feature f;
-					f.description = "Blur map";
-					f.weight = blurFeatureWeight;
-					f.channel = channelProcessed;
+		break;
 
-					cv::Mat featureMap = defocusBlurMap(imgi);
 
-					FeatureMap fm;
-					fm.type  = 0;
-					fm.level = 0;
-					fm.channel = channelProcessed;
+		case 'B':
 
-					cv::resize(featureMap, fm.map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-					f.maps.push_back(fm);
+			{
+				f.description = "Blur map";
+				f.weight = blurFeatureWeight;
 
+				cv::Mat featureMap = defocusBlurMap(pyr.imgi);
 
-					features.push_back(f);
-					++channelProcessed;
-				}
+				FeatureMap fm;
+				fm.type  = 0;
+				fm.level = 0;
 
-			break;
+				cv::resize(featureMap, fm.map, mapSize, 0, 0, cv::INTER_AREA);
+				f.maps.push_back(fm);
 
+				produced = 1;
+			}
 
-			case 'S': 
-			
-				{
-					Feature f = segmentationFeature(img);
-					f.channel = channelProcessed;
-					for(std::list<FeatureMap>::iterator it = f.maps.begin() ; it !=  f.maps.end() ; ++it) {
-						it->channel = channelProcessed;
-					}
-					features.push_back(f);
-					++channelProcessed;
-				}
+		break;
 
 
+		case 'S': 
+		
+			f = segmentationFeature(img);
+			produced = 1;
 
-			default:
-			
-				break;
-		}
+		break;
 	}
 }
 
-void GBVS::getPerspectiveFeatureJob(const cv::Mat& img, cv::Mat &output, double *reliability) const {
-	output = vanishingLineFeatureMapF64C3(img, reliability);
+void GBVS::getPerspectiveFeatureJob(const cv::Mat& img, std::vector<cv::Mat> &outputs, std::vector<double> &reliability, int i) const {
+	outputs[i] = vanishingLineFeatureMapF64C3(img, &reliability[i]);
 }
 
 
@@ -1701,111 +2253,83 @@ cv::Mat GBVS::defocusBlurMap(const cv::Mat& image) const {
 
 
 
-cv::Mat GBVS::faceFeaturesDectection(const cv::Mat& image) {
-
-	cv::Mat gray;
+// The detectors run on a grey copy of the image downscaled to faceDetectionSize, the Gaussian of each 
+// detection is then drawn in the full resolution map. The classifiers are the ones of the calling 
+// thread (see CascadePool), so the face channel can be computed by several workers at once.
+cv::Mat GBVS::faceFeaturesDectection(const cv::Mat& image) const {
 
 	// -------------------------------------------------------------------------------------------
 	// check user input
 
-
-	if(image.channels() == 3 && image.type() == CV_8UC3) {
-		cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-	} else {
-		if(image.channels() == 1 && image.type() == CV_32FC1) {
-			gray = cv::Mat(image.rows, image.cols, CV_8UC1, cv::Scalar(0));
-			for(int i = 0 ; i < image.rows*image.cols ; ++i) {
-				gray.data[i] = static_cast<unsigned char>(std::max(0.f, std::min(255.f, reinterpret_cast<float*>(image.data)[i] * 255.f)));
-			}
-		}
-		if(image.channels() == 1 && image.type() == CV_64FC1) {
-			gray = cv::Mat(image.rows, image.cols, CV_8UC1, cv::Scalar(0));
-			for(int i = 0 ; i < image.rows*image.cols ; ++i) {
-				gray.data[i] = static_cast<unsigned char>(std::max(0., std::min(255., reinterpret_cast<double*>(image.data)[i] * 255.)));
-			}
-		}
-
-		if(gray.empty()) {
-			throw std::logic_error(std::string("GBVS::faceFeaturesDectection(): Do not know what to do with this input image...\n"));
-		}
+	if(image.channels() != 1 && image.channels() != 3) {
+		throw std::logic_error(std::string("GBVS::faceFeaturesDectection(): Do not know what to do with this input image...\n"));
 	}
 
+	int maxDim = std::max(image.rows, image.cols);
+	double scale = 1;
+	if(faceDetectionSize > 0 && maxDim > faceDetectionSize)
+		scale = static_cast<double>(faceDetectionSize) / maxDim;
 
-	// -------------------------------------------------------------------------------------------
-	// run face feature detector
-
-		
-	if(!initCascadeClassifier) {
-		initCascadeClassifier = true;
-
-		if(face_cascade.load("haarcascade_frontalface_alt.xml")) {
-			faceCascadeEnabled = true;
-		} else {
-			std::cerr<< "[I] cannot open: haarcascade_frontalface_alt.xml" << std::endl;
-		}
+	cv::Mat small;
+	if(scale < 1)
+		cv::resize(image, small, cv::Size(std::max(1, cvRound(image.cols*scale)), std::max(1, cvRound(image.rows*scale))), 0, 0, cv::INTER_AREA);
+	else
+		small = image;
 
-		if(eye_cascade.load("haarcascade_eye_tree_eyeglasses.xml")) {
-			eyeCascadeEnabled = true;
-		} else {
-			std::cerr<< "[I] cannot open: haarcascade_eye_tree_eyeglasses.xml" << std::endl;
-		}
+	// floating point images are in [0, 1]
+	cv::Mat gray;
+	double range = (image.depth() == CV_32F || image.depth() == CV_64F) ? 255. : 1.;
+	if(small.channels() == 3) {
+		cv::Mat small8u;
+		small.convertTo(small8u, CV_8UC3, range);
+		cv::cvtColor(small8u, gray, cv::COLOR_BGR2GRAY);
+	} else {
+		small.convertTo(gray, CV_8UC1, range);
 	}
 
-	bool faceFound = false;
-
-	cv::Mat featureMap (image.rows, image.cols, CV_64FC1, cv::Scalar(0));
-	std::vector<cv::Rect> faceFeatures;
-	if(faceCascadeEnabled)
-		face_cascade.detectMultiScale( gray, faceFeatures, 1.1, 2, 0|cv::CASCADE_SCALE_IMAGE, cv::Size(30, 30) );
-
-	if(faceFeatures.size() > 0) faceFound = true;
-
-	for (size_t k = 0; k < faceFeatures.size(); ++k) {
-        // cv::rectangle(gray, faceFeatures[i], cv::Scalar(0,255,0));
+	// the detections are scaled back to the input image
+	double upscale = 1. / scale;
+	int minSize = std::max(1, cvRound(30*scale));
 
-        float sigma_x =  0.001f*faceFeatures[k].width;
-        float sigma_y = 0.001f*faceFeatures[k].height;
 
-        for(int i = 0 ; i < faceFeatures[k].height ; ++i) {
-            for(int j = 0 ; j < faceFeatures[k].width ; ++j) {
+	// -------------------------------------------------------------------------------------------
+	// run face feature detector
 
-                float fi = static_cast<float>(i - faceFeatures[k].height / 2) / faceFeatures[k].height;
-                float fj = static_cast<float>(j - faceFeatures[k].width  / 2) / faceFeatures[k].width;
-                featureMap.at<double>(i+faceFeatures[k].y,j+faceFeatures[k].x) = std::max(featureMap.at<double>(i+faceFeatures[k].y,j+faceFeatures[k].x), static_cast<double>(std::exp(-((fj*fj)/sigma_x + (fi*fi)/sigma_y))));
-            }
-        }
-    }
+	cv::Mat featureMap (image.rows, image.cols, CV_64FC1, cv::Scalar(0));
+	cv::Rect imageRect(0, 0, image.cols, image.rows);
 
-    faceFeatures.clear();
-	if(faceCascadeEnabled)
-		eye_cascade.detectMultiScale( gray, faceFeatures, 1.1, 2, 0|cv::CASCADE_SCALE_IMAGE, cv::Size(30, 30) );
+	// the eyes are given a wider Gaussian than the faces
+	const CascadePool::Model models[2] = { CascadePool::FrontalFace, CascadePool::EyeGlasses };
+	const float spread[2] = { 0.001f, 0.05f };
 
-	if(faceFeatures.size() > 0) faceFound = true;
+	for(int m = 0 ; m < 2 ; ++m) {
+		cv::CascadeClassifier *cascade = CascadePool::global().get(models[m]);
+		if(cascade == NULL)
+			continue;
 
-	for (size_t k = 0; k < faceFeatures.size(); ++k) {
-        float sigma_x =  0.05f*faceFeatures[k].width;
-        float sigma_y = 0.05f*faceFeatures[k].height;
+		std::vector<cv::Rect> faceFeatures;
+		cascade->detectMultiScale( gray, faceFeatures, 1.1, 2, 0|cv::CASCADE_SCALE_IMAGE, cv::Size(minSize, minSize) );
 
-        for(int i = 0 ; i < faceFeatures[k].height ; ++i) {
-            for(int j = 0 ; j < faceFeatures[k].width ; ++j) {
+		for (size_t k = 0; k < faceFeatures.size(); ++k) {
+			cv::Rect detection(cvRound(faceFeatures[k].x*upscale), cvRound(faceFeatures[k].y*upscale), cvRound(faceFeatures[k].width*upscale), cvRound(faceFeatures[k].height*upscale));
+			cv::Rect drawn = detection & imageRect;
 
-                float fi = static_cast<float>(i - faceFeatures[k].height / 2) / faceFeatures[k].height;
-                float fj = static_cast<float>(j - faceFeatures[k].width  / 2) / faceFeatures[k].width;
-                featureMap.at<double>(i+faceFeatures[k].y,j+faceFeatures[k].x) = std::max(featureMap.at<double>(i+faceFeatures[k].y,j+faceFeatures[k].x), static_cast<double>(std::exp(-((fj*fj)/sigma_x + (fi*fi)/sigma_y))));
-            }
-        }
-    }
+			float sigma_x = spread[m]*detection.width;
+			float sigma_y = spread[m]*detection.height;
 
-    if(faceFound) {
-    	double mx, mn;
-		cv::minMaxLoc(featureMap, &mn, &mx);
+			for(int i = drawn.y ; i < drawn.y + drawn.height ; ++i) {
+				double *row = featureMap.ptr<double>(i);
+				for(int j = drawn.x ; j < drawn.x + drawn.width ; ++j) {
 
-	    // cv::imshow("feature", (featureMap-mn)/(mx-mn));
-	    // cv::waitKey();
-	    
-    } 
+					float fi = static_cast<float>(i - detection.y - detection.height / 2) / detection.height;
+					float fj = static_cast<float>(j - detection.x - detection.width  / 2) / detection.width;
+					row[j] = std::max(row[j], static_cast<double>(std::exp(-((fj*fj)/sigma_x + (fi*fi)/sigma_y))));
+				}
+			}
+		}
+	}
 
-    return featureMap;
+	return featureMap;
 
 }
 
@@ -1947,7 +2471,7 @@ void GBVS::computeActivation() {
 
 	// 			allmaps.push_back(FeatureMap());
 
-	// 			allmaps.back().map = graphsalapply(mapIt->map, grframe, sigma_frac_act, 1, 2, static_cast<float>(tol));
+	// 			allmaps.back().map = graphsalapply(mapIt->map, *grframe, sigma_frac_act, 1, 2, static_cast<float>(tol));
 
 	// 			allmaps.back().type = mapIt->type;
 	// 			allmaps.back().level = mapIt->level;
@@ -1960,6 +2484,28 @@ void GBVS::computeActivation() {
 
 	// --------------- parallel version ----------------
 
+	// shape of the tensor: all the maps have the geometry of the graph
+	int nbLevels = 0;
+	int nbTypes  = 0;
+	const cv::Mat *geometry = NULL;
+	for(std::list<Feature>::iterator it = features.begin() ; it != features.end() ; ++it) {
+		for(std::list<FeatureMap>::iterator mapIt = it->maps.begin() ; mapIt != it->maps.end() ; ++mapIt) {
+			nbLevels = std::max(nbLevels, mapIt->level+1);
+			nbTypes  = std::max(nbTypes, mapIt->type+1);
+
+			if(geometry == NULL)
+				geometry = &mapIt->map;
+			else if(mapIt->map.rows != geometry->rows || mapIt->map.cols != geometry->cols)
+				throw std::logic_error(std::string("GBVS::computeActivation(): the feature maps do not have the same size."));
+		}
+	}
+
+	if(geometry == NULL)
+		return;
+
+	activationTensor.reshape(static_cast<int>(channels.size()), nbLevels, nbTypes, geometry->rows, geometry->cols);
+
+
 	for(std::list<Feature>::iterator it = features.begin() ; it != features.end() ; ++it) {
 		mapWeights[it->channel] = it->weight;
 
@@ -1968,7 +2514,7 @@ void GBVS::computeActivation() {
 			maxType = std::max(maxType, mapIt->type);
 		}
 
-		// allocate memory
+		// copy the maps in the tensor
 		for(int typei = 0 ; typei <= maxType ; ++typei) {
 			for(std::list<FeatureMap>::iterator mapIt = it->maps.begin() ; mapIt != it->maps.end() ; ++mapIt) {
 				if(mapIt->type != typei) continue;
@@ -1982,50 +2528,86 @@ void GBVS::computeActivation() {
 				}
 
 				allmaps.push_back(FeatureMap());
-				allmaps.back().map = mapIt->map;
+				allmaps.back().map = activationTensor.map(mapIt->channel, mapIt->level, mapIt->type);
 				allmaps.back().type = mapIt->type;
 				allmaps.back().level = mapIt->level;
 				allmaps.back().channel = mapIt->channel;
-				allmaps.back().taskDone = false;
+				allmaps.back().activationIters = 0;
+				allmaps.back().normalizationIters = 0;
+
+				mapIt->map.convertTo(allmaps.back().map, CV_64FC1);
 			}
 		}
 	}
 
-	// run the activation in N threads.
-	boost::thread_group g;
-	for(int i = 0 ; i < nbThreads ; ++i) {
-		g.create_thread(boost::bind(&GBVS::computeActivationJob, this));
+	// run the activation on the pool, with nbThreads participants.
+	std::vector<FeatureMap*> maps;
+	int nbTasks = activationTasks(maps, activationBatchSize());
+	ThreadPool::global().parallelFor(nbTasks, boost::bind(&GBVS::computeActivationJob, this, boost::cref(maps), _1), nbThreads);
+
+}
+
+void GBVS::printIterations() const {
+	int activation = 0;
+	int normalization = 0;
+
+	for(std::list<FeatureMap>::const_iterator it = allmaps.begin() ; it != allmaps.end() ; ++it) {
+		std::cerr << "[I] map channel: " << channels[it->channel] << " level: " << it->level << " type: " << it->type 
+				  << "\tactivation: " << it->activationIters << " iterations\tnormalization: " << it->normalizationIters << " iterations" << std::endl;
+
+		activation += it->activationIters;
+		normalization += it->normalizationIters;
 	}
 
-	g.join_all();
+	std::cerr << "[I] " << allmaps.size() << " maps, activation: " << activation << " iterations, normalization: " << normalization << " iterations" << std::endl;
+}
+
+
 
+// size of the groups of maps processed by one task: one, or activationBatch maps when they are solved
+// together (the batched solver only runs the power iterations)
+int GBVS::activationBatchSize() const {
+	return (graphEngine == 2 && eigenSolver == 1) ? std::max(1, activationBatch) : 1;
 }
 
-void GBVS::computeActivationJob() {
 
-	bool taskFound = true;
+// same for the normalization. Only the normalization by the activation (normalizationType 2) has a batched
+// solver: the other normalizations process one map per task, so that all their maps run in parallel.
+int GBVS::normalizationBatchSize() const {
+	return (normalizationType == 2) ? activationBatchSize() : 1;
+}
 
-	// while the thread can find something to do, do it.
-	while(taskFound) {
-		taskFound = false;
-		FeatureMap *feature = NULL;
 
-		gbvs_mutex.lock();
-		for(std::list<FeatureMap>::iterator it = allmaps.begin() ; it != allmaps.end() && !taskFound ; ++it) {
-			if(!it->taskDone) {
-				taskFound = true;
-				it->taskDone = true; // mark it as done. So other threads don't take this job
-				feature = &(*it);
-				break;
-			}
-		}
+// the maps to activate, and the number of tasks needed to process them by groups of batch maps
+int GBVS::activationTasks(std::vector<FeatureMap*> &maps, int batch) {
+	maps.clear();
+	for(std::list<FeatureMap>::iterator it = allmaps.begin() ; it != allmaps.end() ; ++it) {
+		maps.push_back(&(*it));
+	}
+
+	return (static_cast<int>(maps.size()) + batch - 1) / batch;
+}
 
-		gbvs_mutex.unlock();
 
-		// if a task was found, do the job.
-		if(taskFound) {
-			feature->map = graphsalapply(feature->map, grframe, sigma_frac_act, 1, 2, static_cast<float>(tol));
-		}
+
+// activation of the maps [task*batch, (task+1)*batch)
+void GBVS::computeActivationJob(const std::vector<FeatureMap*> &maps, int task) {
+	int batch = activationBatchSize();
+	size_t first = static_cast<size_t>(task) * batch;
+	size_t last  = std::min(maps.size(), first + batch);
+
+	if(last - first == 1) {
+		graphsalapply(maps[first]->map, *grframe, sigma_frac_act, 1, 2, static_cast<float>(tol), &maps[first]->activationIters).copyTo(maps[first]->map);
+	} else {
+		std::vector<cv::Mat*> group;
+		for(size_t i = first ; i < last ; ++i)
+			group.push_back(&maps[i]->map);
+
+		std::vector<int> iterations;
+		graphsalapplyBatch(group, *grframe, sigma_frac_act, 1, 2, static_cast<float>(tol), &iterations);
+
+		for(size_t i = first ; i < last ; ++i)
+			maps[i]->activationIters = iterations[i-first];
 	}
 }
 
@@ -2039,9 +2621,9 @@ void GBVS::normalizeActivation() {
 
 	// for(std::list<FeatureMap>::iterator mapIt = allmaps.begin() ; mapIt != allmaps.end() ; ++mapIt) {
 	// 	if(normalizationType == 1) {
-	// 		mapIt->map = graphsalapply(mapIt->map, grframe, sigma_frac_act, num_norm_iters, 4, static_cast<float>(tol));
+	// 		mapIt->map = graphsalapply(mapIt->map, *grframe, sigma_frac_act, num_norm_iters, 4, static_cast<float>(tol));
 	// 	} else if (normalizationType == 2) {
-	// 		mapIt->map = graphsalapply(mapIt->map, grframe, sigma_frac_act, num_norm_iters, 1, static_cast<float>(tol));
+	// 		mapIt->map = graphsalapply(mapIt->map, *grframe, sigma_frac_act, num_norm_iters, 1, static_cast<float>(tol));
 	// 	} else {
 	// 		mapIt->map = maxNormalizeStdGBVS(mapIt->map);
 	// 	}
@@ -2050,87 +2632,87 @@ void GBVS::normalizeActivation() {
 
 	// --------------- parallel version ----------------
 
-	// mark all feature maps as non-activated
-	for(std::list<FeatureMap>::iterator mapIt = allmaps.begin() ; mapIt != allmaps.end() ; ++mapIt) {
-		mapIt->taskDone = false;
-	}
-
-
-	// run the normalization in N threads.
-	boost::thread_group g;
-	for(int i = 0 ; i < nbThreads ; ++i) {
-		g.create_thread(boost::bind(&GBVS::normalizeActivationJob, this));
-	}
-
-	g.join_all();
+	// run the normalization on the pool, with nbThreads participants.
+	std::vector<FeatureMap*> maps;
+	int nbTasks = activationTasks(maps, normalizationBatchSize());
+	ThreadPool::global().parallelFor(nbTasks, boost::bind(&GBVS::normalizeActivationJob, this, boost::cref(maps), _1), nbThreads);
 
 }
 
 
-void GBVS::normalizeActivationJob() {
-	bool taskFound = true;
-
-	// while the thread can find something to do, do it.
-	while(taskFound) {
-		taskFound = false;
-		FeatureMap *feature = NULL;
+// normalization of the maps [task*batch, (task+1)*batch)
+void GBVS::normalizeActivationJob(const std::vector<FeatureMap*> &maps, int task) {
+	int batch = normalizationBatchSize();
+	size_t first = static_cast<size_t>(task) * batch;
+	size_t last  = std::min(maps.size(), first + batch);
 
+	if(last - first > 1) {
+		std::vector<cv::Mat*> group;
+		for(size_t i = first ; i < last ; ++i)
+			group.push_back(&maps[i]->map);
 
-		gbvs_mutex.lock();
-		for(std::list<FeatureMap>::iterator it = allmaps.begin() ; it != allmaps.end()  && !taskFound  ; ++it) {
-			if(!it->taskDone) {
-				taskFound = true;
-				it->taskDone = true; // mark it as done. So other threads don't take this job
-				feature = &(*it);
-				break;
-			}
-		}
-		gbvs_mutex.unlock();
+		std::vector<int> iterations;
+		graphsalapplyBatch(group, *grframe, sigma_frac_act, num_norm_iters, 1, static_cast<float>(tol), &iterations);
 
+		for(size_t i = first ; i < last ; ++i)
+			maps[i]->normalizationIters = iterations[i-first];
+		return;
+	}
 
+	for(size_t i = first ; i < last ; ++i) {
+		FeatureMap *feature = maps[i];
 
-		// if a task was found, do the job.
-		if(taskFound) {
-			if(normalizationType == 1) {
-				feature->map = graphsalapply(feature->map, grframe, sigma_frac_act, num_norm_iters, 4, static_cast<float>(tol));
-			} else if (normalizationType == 2) {
-				feature->map = graphsalapply(feature->map, grframe, sigma_frac_act, num_norm_iters, 1, static_cast<float>(tol));
-			} else {
-				feature->map = maxNormalizeStdGBVS(feature->map);
-			}			
+		// the results are copied back in the tensor
+		if(normalizationType == 1) {
+			graphsalapply(feature->map, *grframe, sigma_frac_act, num_norm_iters, 4, static_cast<float>(tol), &feature->normalizationIters).copyTo(feature->map);
+		} else if (normalizationType == 2) {
+			graphsalapply(feature->map, *grframe, sigma_frac_act, num_norm_iters, 1, static_cast<float>(tol), &feature->normalizationIters).copyTo(feature->map);
+		} else {
+			maxNormalizeStdGBVS(feature->map).copyTo(feature->map);
 		}
 	}
 }
 
 
+// the maps of a channel are summed in its plane of the tensor. The channels are listed in the order of 
+// their first map.
 void GBVS::averageByFeatureChannel() {
-	std::vector<int> nfmap(channels.length(), 0);
+	std::vector<char> started(channels.length(), 0);
+	std::vector<int>  order;
 
 	for(std::list<FeatureMap>::iterator mapIt = allmaps.begin() ; mapIt != allmaps.end() ; ++mapIt) {
-		std::list<FeatureMap>::iterator channelIt;
-		for(channelIt = channelMaps.begin() ; channelIt != channelMaps.end() ; ++channelIt) {
-			if(channelIt->channel == mapIt->channel) {
-				channelIt->map = channelIt->map + mapIt->map;
-				++nfmap[channelIt->channel];
-				break;
-			}
-		}
+		cv::Mat plane = activationTensor.channel(mapIt->channel);
 
-		if(channelIt == channelMaps.end()) {
-			channelMaps.push_back(*mapIt);
-			nfmap[mapIt->channel] = 1;
+		if(!started[mapIt->channel]) {
+			mapIt->map.copyTo(plane);
+			started[mapIt->channel] = 1;
+			order.push_back(mapIt->channel);
+		} else {
+			plane += mapIt->map;
 		}
 	}
 
+	for(size_t i = 0 ; i < order.size() ; ++i) {
+		int channel = order[i];
+
+		channelMaps.push_back(FeatureMap());
+		channelMaps.back().map = activationTensor.channel(channel);
+		channelMaps.back().channel = channel;
+		channelMaps.back().type = 0;
+		channelMaps.back().level = 0;
+		channelMaps.back().activationIters = 0;
+		channelMaps.back().normalizationIters = 0;
+	}
+
 	for(std::list<FeatureMap>::iterator channelIt = channelMaps.begin() ; channelIt != channelMaps.end() ; ++channelIt) {
 
 		if(normalizeTopChannelMaps == 1) {
 			if(normalizationType == 1) {
-				channelIt->map = graphsalapply(channelIt->map, grframe, sigma_frac_act, num_norm_iters, 4, static_cast<float>(tol));
+				graphsalapply(channelIt->map, *grframe, sigma_frac_act, num_norm_iters, 4, static_cast<float>(tol)).copyTo(channelIt->map);
 			} else if (normalizationType == 2) {
-				channelIt->map = graphsalapply(channelIt->map, grframe, sigma_frac_act, num_norm_iters, 1, static_cast<float>(tol));
+				graphsalapply(channelIt->map, *grframe, sigma_frac_act, num_norm_iters, 1, static_cast<float>(tol)).copyTo(channelIt->map);
 			} else {
-				channelIt->map = maxNormalizeStdGBVS(channelIt->map);
+				maxNormalizeStdGBVS(channelIt->map).copyTo(channelIt->map);
 			}
 		}
 
@@ -2528,34 +3110,53 @@ cv::Mat GBVS::safeDivideGBVS(const cv::Mat &u, const cv::Mat &v) const {
 
 
 // The contrast function only compute the standard deviation of pixels in a bounding box defined by the second parameter... 
+// The window [i-mo, i+mo) x [j-mo, j+mo) is clipped to the image, the sums are read from integral images
+// of v and v^2 so the cost does not depend on the size of the window. The values are centered on their
+// mean first, which does not change the variance but limits the cancellation in sumSq - ni * mean^2.
 cv::Mat GBVS::contrast(const cv::Mat &img, int size) const {
 
 	cv::Mat ctr(img.rows, img.cols, CV_64FC1, 1);
 
 	int mo = size / 2;
 
+	double offset = cv::mean(img)[0];
+
+	cv::Mat sum   = cv::Mat::zeros(img.rows + 1, img.cols + 1, CV_64FC1);
+	cv::Mat sumSq = cv::Mat::zeros(img.rows + 1, img.cols + 1, CV_64FC1);
+
 	for(int i = 0 ; i < img.rows ; ++i) {
+		double rowPix   = 0;
+		double rowSqPix = 0;
+
+		for(int j = 0 ; j < img.cols ; ++j) {
+			double v = img.at<double>(i,j) - offset;
+			rowPix   += v;
+			rowSqPix += v*v;
+
+			sum.at<double>(i+1,j+1)   = sum.at<double>(i,j+1)   + rowPix;
+			sumSq.at<double>(i+1,j+1) = sumSq.at<double>(i,j+1) + rowSqPix;
+		}
+	}
+
+	for(int i = 0 ; i < img.rows ; ++i) {
+		int i0 = std::max(0, i - mo);
+		int i1 = std::min(img.rows, i + mo);
+
 		for(int j = 0 ; j < img.cols ; ++j) {
+			int j0 = std::max(0, j - mo);
+			int j1 = std::min(img.cols, j + mo);
 
 			double sumPix = 0;
-			double sumSqPix = 0;
 			int ni = 0;
 
-			for(int ii = i - mo ; ii < i + mo ; ++ii) {
-				for(int jj = j - mo ; jj < j + mo ; ++jj) {
-					if ( ii < 0 || ii >= img.rows || jj < 0 || jj >= img.cols ) continue;
+			if(i1 > i0 && j1 > j0) {
+				ni = (i1 - i0) * (j1 - j0);
 
-					double v = img.at<double>(ii,jj);
-					sumPix   += v;
-					sumSqPix += v*v;
+				sumPix          = sum.at<double>(i1,j1)   - sum.at<double>(i0,j1)   - sum.at<double>(i1,j0)   + sum.at<double>(i0,j0);
+				double sumSqPix = sumSq.at<double>(i1,j1) - sumSq.at<double>(i0,j1) - sumSq.at<double>(i1,j0) + sumSq.at<double>(i0,j0);
 
-					++ni;
-				}
-			}
-
-			if(ni > 0) {
 				sumPix   /= ni;
-				sumPix = (sumSqPix - ni * sumPix * sumPix) / ni;
+				sumPix = std::max(0.0, (sumSqPix - ni * sumPix * sumPix) / ni);
 			}
 
 			ctr.at<double>(i,j) = sumPix;
@@ -2575,448 +3176,18 @@ void GBVS::rgb2dkl(cv::Mat &imgR, cv::Mat &imgG, cv::Mat &imgB, cv::Mat &imgL, c
 	imgC1 = cv::Mat(imgR.rows, imgR.cols, CV_64FC1, 1);
 	imgC2 = cv::Mat(imgR.rows, imgR.cols, CV_64FC1, 1);
 
-	double lut_rgb[256][3] = {
-	    {0.024935, 0.0076954, 0.042291},
-	    {0.024974, 0.0077395, 0.042346},
-	    {0.025013, 0.0077836, 0.042401},
-	    {0.025052, 0.0078277, 0.042456},
-	    {0.025091, 0.0078717, 0.042511},
-	    {0.02513, 0.0079158, 0.042566},
-	    {0.025234, 0.007992, 0.042621},
-	    {0.025338, 0.0080681, 0.042676},
-	    {0.025442, 0.0081443, 0.042731},
-	    {0.025545, 0.0082204, 0.042786},
-	    {0.025649, 0.0082966, 0.042841},
-	    {0.025747, 0.0084168, 0.042952},
-	    {0.025844, 0.0085371, 0.043062},
-	    {0.025942, 0.0086573, 0.043172},
-	    {0.026039, 0.0087776, 0.043282},
-	    {0.026136, 0.0088978, 0.043392},
-	    {0.026234, 0.0090581, 0.043502},
-	    {0.026331, 0.0092184, 0.043612},
-	    {0.026429, 0.0093788, 0.043722},
-	    {0.026526, 0.0095391, 0.043833},
-	    {0.026623, 0.0096994, 0.043943},
-	    {0.026818, 0.0099198, 0.044141},
-	    {0.027013, 0.01014, 0.044339},
-	    {0.027208, 0.010361, 0.044537},
-	    {0.027403, 0.010581, 0.044736},
-	    {0.027597, 0.010802, 0.044934},
-	    {0.027857, 0.010994, 0.04522},
-	    {0.028117, 0.011186, 0.045507},
-	    {0.028377, 0.011379, 0.045793},
-	    {0.028636, 0.011571, 0.046079},
-	    {0.028896, 0.011764, 0.046366},
-	    {0.029104, 0.012068, 0.046652},
-	    {0.029312, 0.012373, 0.046938},
-	    {0.029519, 0.012677, 0.047225},
-	    {0.029727, 0.012982, 0.047511},
-	    {0.029935, 0.013287, 0.047797},
-	    {0.030273, 0.013663, 0.048326},
-	    {0.03061, 0.01404, 0.048855},
-	    {0.030948, 0.014417, 0.049383},
-	    {0.031286, 0.014794, 0.049912},
-	    {0.031623, 0.01517, 0.050441},
-	    {0.032156, 0.015707, 0.051035},
-	    {0.032688, 0.016244, 0.05163},
-	    {0.033221, 0.016782, 0.052225},
-	    {0.033753, 0.017319, 0.052819},
-	    {0.034286, 0.017856, 0.053414},
-	    {0.034961, 0.018693, 0.054493},
-	    {0.035636, 0.019531, 0.055573},
-	    {0.036312, 0.020369, 0.056652},
-	    {0.036987, 0.021206, 0.057731},
-	    {0.037662, 0.022044, 0.058811},
-	    {0.038623, 0.023246, 0.060044},
-	    {0.039584, 0.024449, 0.061278},
-	    {0.040545, 0.025651, 0.062511},
-	    {0.041506, 0.026854, 0.063744},
-	    {0.042468, 0.028056, 0.064978},
-	    {0.043857, 0.029659, 0.066806},
-	    {0.045247, 0.031263, 0.068634},
-	    {0.046636, 0.032866, 0.070463},
-	    {0.048026, 0.034469, 0.072291},
-	    {0.049416, 0.036072, 0.074119},
-	    {0.051221, 0.038156, 0.076476},
-	    {0.053026, 0.04024, 0.078833},
-	    {0.054831, 0.042325, 0.081189},
-	    {0.056636, 0.044409, 0.083546},
-	    {0.058442, 0.046493, 0.085903},
-	    {0.06039, 0.048737, 0.087996},
-	    {0.062338, 0.050982, 0.090088},
-	    {0.064286, 0.053226, 0.092181},
-	    {0.066234, 0.055471, 0.094273},
-	    {0.068182, 0.057715, 0.096366},
-	    {0.070519, 0.06012, 0.098921},
-	    {0.072857, 0.062525, 0.10148},
-	    {0.075195, 0.06493, 0.10403},
-	    {0.077532, 0.067335, 0.10659},
-	    {0.07987, 0.069739, 0.10914},
-	    {0.082208, 0.072345, 0.11176},
-	    {0.084545, 0.07495, 0.11438},
-	    {0.086883, 0.077555, 0.117},
-	    {0.089221, 0.08016, 0.11963},
-	    {0.091558, 0.082766, 0.12225},
-	    {0.094026, 0.085611, 0.12533},
-	    {0.096494, 0.088457, 0.12841},
-	    {0.098961, 0.091303, 0.1315},
-	    {0.10143, 0.094148, 0.13458},
-	    {0.1039, 0.096994, 0.13767},
-	    {0.10688, 0.10028, 0.14119},
-	    {0.10987, 0.10357, 0.14471},
-	    {0.11286, 0.10685, 0.14824},
-	    {0.11584, 0.11014, 0.15176},
-	    {0.11883, 0.11343, 0.15529},
-	    {0.12208, 0.11695, 0.15903},
-	    {0.12532, 0.12048, 0.16278},
-	    {0.12857, 0.12401, 0.16652},
-	    {0.13182, 0.12754, 0.17026},
-	    {0.13506, 0.13106, 0.17401},
-	    {0.1387, 0.13499, 0.17819},
-	    {0.14234, 0.13892, 0.18238},
-	    {0.14597, 0.14285, 0.18656},
-	    {0.14961, 0.14677, 0.19075},
-	    {0.15325, 0.1507, 0.19493},
-	    {0.15727, 0.15519, 0.19956},
-	    {0.1613, 0.15968, 0.20419},
-	    {0.16532, 0.16417, 0.20881},
-	    {0.16935, 0.16866, 0.21344},
-	    {0.17338, 0.17315, 0.21806},
-	    {0.17805, 0.17796, 0.22291},
-	    {0.18273, 0.18277, 0.22775},
-	    {0.1874, 0.18758, 0.2326},
-	    {0.19208, 0.19238, 0.23744},
-	    {0.19675, 0.19719, 0.24229},
-	    {0.20156, 0.20224, 0.24758},
-	    {0.20636, 0.20729, 0.25286},
-	    {0.21117, 0.21234, 0.25815},
-	    {0.21597, 0.21739, 0.26344},
-	    {0.22078, 0.22244, 0.26872},
-	    {0.2261, 0.22806, 0.27423},
-	    {0.23143, 0.23367, 0.27974},
-	    {0.23675, 0.23928, 0.28524},
-	    {0.24208, 0.24489, 0.29075},
-	    {0.2474, 0.2505, 0.29626},
-	    {0.25299, 0.25651, 0.3022},
-	    {0.25857, 0.26253, 0.30815},
-	    {0.26416, 0.26854, 0.3141},
-	    {0.26974, 0.27455, 0.32004},
-	    {0.27532, 0.28056, 0.32599},
-	    {0.28156, 0.28697, 0.33238},
-	    {0.28779, 0.29339, 0.33877},
-	    {0.29403, 0.2998, 0.34515},
-	    {0.30026, 0.30621, 0.35154},
-	    {0.30649, 0.31263, 0.35793},
-	    {0.3126, 0.31904, 0.36388},
-	    {0.3187, 0.32545, 0.36982},
-	    {0.32481, 0.33186, 0.37577},
-	    {0.33091, 0.33828, 0.38172},
-	    {0.33701, 0.34469, 0.38767},
-	    {0.34325, 0.3511, 0.39361},
-	    {0.34948, 0.35752, 0.39956},
-	    {0.35571, 0.36393, 0.40551},
-	    {0.36195, 0.37034, 0.41145},
-	    {0.36818, 0.37675, 0.4174},
-	    {0.37429, 0.38317, 0.42313},
-	    {0.38039, 0.38958, 0.42885},
-	    {0.38649, 0.39599, 0.43458},
-	    {0.3926, 0.4024, 0.44031},
-	    {0.3987, 0.40882, 0.44604},
-	    {0.40494, 0.41523, 0.45198},
-	    {0.41117, 0.42164, 0.45793},
-	    {0.4174, 0.42806, 0.46388},
-	    {0.42364, 0.43447, 0.46982},
-	    {0.42987, 0.44088, 0.47577},
-	    {0.43623, 0.44689, 0.48128},
-	    {0.4426, 0.45291, 0.48678},
-	    {0.44896, 0.45892, 0.49229},
-	    {0.45532, 0.46493, 0.4978},
-	    {0.46169, 0.47094, 0.5033},
-	    {0.46792, 0.47695, 0.50837},
-	    {0.47416, 0.48297, 0.51344},
-	    {0.48039, 0.48898, 0.5185},
-	    {0.48662, 0.49499, 0.52357},
-	    {0.49286, 0.501, 0.52863},
-	    {0.49805, 0.50701, 0.53392},
-	    {0.50325, 0.51303, 0.53921},
-	    {0.50844, 0.51904, 0.54449},
-	    {0.51364, 0.52505, 0.54978},
-	    {0.51883, 0.53106, 0.55507},
-	    {0.52442, 0.53667, 0.55969},
-	    {0.53, 0.54228, 0.56432},
-	    {0.53558, 0.5479, 0.56894},
-	    {0.54117, 0.55351, 0.57357},
-	    {0.54675, 0.55912, 0.57819},
-	    {0.55182, 0.56433, 0.58304},
-	    {0.55688, 0.56954, 0.58789},
-	    {0.56195, 0.57475, 0.59273},
-	    {0.56701, 0.57996, 0.59758},
-	    {0.57208, 0.58517, 0.60242},
-	    {0.57675, 0.58998, 0.60639},
-	    {0.58143, 0.59479, 0.61035},
-	    {0.5861, 0.5996, 0.61432},
-	    {0.59078, 0.60441, 0.61828},
-	    {0.59545, 0.60922, 0.62225},
-	    {0.60065, 0.61403, 0.62709},
-	    {0.60584, 0.61884, 0.63194},
-	    {0.61104, 0.62365, 0.63678},
-	    {0.61623, 0.62846, 0.64163},
-	    {0.62143, 0.63327, 0.64648},
-	    {0.62584, 0.63808, 0.65088},
-	    {0.63026, 0.64289, 0.65529},
-	    {0.63468, 0.6477, 0.65969},
-	    {0.63909, 0.65251, 0.6641},
-	    {0.64351, 0.65731, 0.6685},
-	    {0.64857, 0.66132, 0.67269},
-	    {0.65364, 0.66533, 0.67687},
-	    {0.6587, 0.66934, 0.68106},
-	    {0.66377, 0.67335, 0.68524},
-	    {0.66883, 0.67735, 0.68943},
-	    {0.67273, 0.68136, 0.69361},
-	    {0.67662, 0.68537, 0.6978},
-	    {0.68052, 0.68938, 0.70198},
-	    {0.68442, 0.69339, 0.70617},
-	    {0.68831, 0.69739, 0.71035},
-	    {0.69221, 0.7022, 0.7141},
-	    {0.6961, 0.70701, 0.71784},
-	    {0.7, 0.71182, 0.72159},
-	    {0.7039, 0.71663, 0.72533},
-	    {0.70779, 0.72144, 0.72907},
-	    {0.71169, 0.72505, 0.73348},
-	    {0.71558, 0.72866, 0.73789},
-	    {0.71948, 0.73226, 0.74229},
-	    {0.72338, 0.73587, 0.7467},
-	    {0.72727, 0.73948, 0.7511},
-	    {0.73247, 0.74349, 0.75507},
-	    {0.73766, 0.74749, 0.75903},
-	    {0.74286, 0.7515, 0.763},
-	    {0.74805, 0.75551, 0.76696},
-	    {0.75325, 0.75952, 0.77093},
-	    {0.75714, 0.76393, 0.77599},
-	    {0.76104, 0.76834, 0.78106},
-	    {0.76494, 0.77275, 0.78612},
-	    {0.76883, 0.77715, 0.79119},
-	    {0.77273, 0.78156, 0.79626},
-	    {0.77792, 0.78677, 0.80132},
-	    {0.78312, 0.79198, 0.80639},
-	    {0.78831, 0.79719, 0.81145},
-	    {0.79351, 0.8024, 0.81652},
-	    {0.7987, 0.80762, 0.82159},
-	    {0.80519, 0.81283, 0.82687},
-	    {0.81169, 0.81804, 0.83216},
-	    {0.81818, 0.82325, 0.83744},
-	    {0.82468, 0.82846, 0.84273},
-	    {0.83117, 0.83367, 0.84802},
-	    {0.83636, 0.83888, 0.85286},
-	    {0.84156, 0.84409, 0.85771},
-	    {0.84675, 0.8493, 0.86256},
-	    {0.85195, 0.85451, 0.8674},
-	    {0.85714, 0.85972, 0.87225},
-	    {0.86364, 0.86613, 0.87819},
-	    {0.87013, 0.87255, 0.88414},
-	    {0.87662, 0.87896, 0.89009},
-	    {0.88312, 0.88537, 0.89604},
-	    {0.88961, 0.89178, 0.90198},
-	    {0.8961, 0.8986, 0.90947},
-	    {0.9026, 0.90541, 0.91696},
-	    {0.90909, 0.91222, 0.92445},
-	    {0.91558, 0.91904, 0.93194},
-	    {0.92208, 0.92585, 0.93943},
-	    {0.92857, 0.93307, 0.94493},
-	    {0.93506, 0.94028, 0.95044},
-	    {0.94156, 0.94749, 0.95595},
-	    {0.94805, 0.95471, 0.96145},
-	    {0.95455, 0.96192, 0.96696},
-	    {0.96364, 0.96954, 0.97357},
-	    {0.97273, 0.97715, 0.98018},
-	    {0.98182, 0.98477, 0.98678},
-	    {0.99091, 0.99238, 0.99339},
-	    {1, 1, 1 }};
-
-    double lms0[] = { 34.918538957799996, 19.314796676499999, 0.585610818500000 };
-    double m[]    = { 18.32535,  44.60077,   7.46216, 4.09544,  28.20135,   6.66066, 0.02114,   0.10325,   1.05258 };  
-    double fac    = 1.0 / (lms0[0] + lms0[1]);
-    double mm[] = { sqrt(3.0)*fac, sqrt(3.0)*fac, 0.0, sqrt(lms0[0]*lms0[0]+lms0[1]*lms0[1])/lms0[0]*fac, -sqrt(lms0[0]*lms0[0]+lms0[1]*lms0[1])/lms0[1]*fac, 0.0, -fac, -fac, (lms0[0] + lms0[1]) / lms0[2] * fac };
-
-    for(int i = 0 ; i < imgL.rows ; ++i) {
-		for(int j = 0 ; j < imgL.cols ; ++j) {
-			double aa1 = lut_rgb[static_cast<int>(255*reinterpret_cast<double*>(imgR.data)[i*imgR.cols+j])][0];
-			double aa2 = lut_rgb[static_cast<int>(255*reinterpret_cast<double*>(imgG.data)[i*imgR.cols+j])][1];
-			double aa3 = lut_rgb[static_cast<int>(255*reinterpret_cast<double*>(imgB.data)[i*imgR.cols+j])][2];
-
-			double lms1 = m[0] * aa1 + m[1] * aa2 + m[2] * aa3 - lms0[0];
-			double lms2 = m[3] * aa1 + m[4] * aa2 + m[5] * aa3 - lms0[1];
-			double lms3 = m[6] * aa1 + m[7] * aa2 + m[8] * aa3 - lms0[2];
-
-			double dkl1 = mm[0] * lms1 + mm[1] * lms2 + mm[2] * lms3;
-			double dkl2 = mm[3] * lms1 + mm[4] * lms2 + mm[5] * lms3;
-			double dkl3 = mm[6] * lms1 + mm[7] * lms2 + mm[8] * lms3;
-
-			reinterpret_cast<double*>(imgL.data)[i*imgR.cols+j] = dkl1 * 0.5774;
-			reinterpret_cast<double*>(imgC1.data)[i*imgR.cols+j] = dkl2 * 2.7525;
-			reinterpret_cast<double*>(imgC2.data)[i*imgR.cols+j] = dkl3 * 0.4526;
-		}
-	}
-
-}
-
-
-
-
-
-// ######################################################################
-// kernel: 1 5 10 10 5 1
-void GBVS::lowPass6yDecY(double* sptr, double* rptr, int w, int hs) const {
-  int x, y;
-  int hr = hs / 2;
-  if (hr == 0) hr = 1;
-
-  /* if (hs <= 1)
-     result = src;
-     else 
-  */ 
-  if (hs == 2)
-    for (x = 0; x < w; ++x)
-      {
-        // use kernel [1 1]^T / 2
-        *rptr++ = (sptr[0] + sptr[1]) / 2.0;
-        sptr += 2;
-      }
-  else if (hs == 3)
-    for (x = 0; x < w; ++x)
-      {
-        // use kernel [1 2 1]^T / 4
-        *rptr++ = (sptr[0] + sptr[1] * 2.0 + sptr[2]) / 4.0;
-        sptr += 3;
-      }
-  else // general case with hs >= 4
-    for (x = 0; x < w; ++x)
-      {
-        // top most point - use kernel [10 10 5 1]^T / 26
-        *rptr++ = ((sptr[0] + sptr[1]) * 10.0 + 
-		   sptr[2] * 5.0 + sptr[3]) / 26.0;
-        //++sptr;
-        
-        // general case
-        for (y = 0; y < (hs - 5); y += 2)
-          {
-            // use kernel [1 5 10 10 5 1]^T / 32
-            *rptr++ = ((sptr[1] + sptr[4])  *  5.0 +
-                       (sptr[2] + sptr[3])  * 10.0 +
-                       (sptr[0] + sptr[5])) / 32.0;
-            sptr += 2;
-          }
-        
-        // find out how to treat the bottom most point
-        if (y == (hs - 5))
-          {
-            // use kernel [1 5 10 10 5]^T / 31
-	    *rptr++ = ((sptr[1] + sptr[4])  *  5.0 +
-		       (sptr[2] + sptr[3])  * 10.0 +
-		       sptr[0])            / 31.0;
-            sptr += 5;
-          }
-        else
-          {
-            // use kernel [1 5 10 10]^T / 26
-            *rptr++ = ( sptr[0] + sptr[1]  *  5.0 +
-			(sptr[2] + sptr[3]) * 10.0) / 26.0;
-            sptr += 4;
-          }
-      }
-}
-
-// ######################################################################
-// kernel: 1 5 10 10 5 1
-void GBVS::lowPass6xDecX(double* sptr, double* rptr, int ws, int h) const {
-  int x,y;
-  const int h2 = h * 2, h3 = h * 3, h4 = h * 4, h5 = h * 5;
-  int wr = ws / 2;
-  if (wr == 0) wr = 1;
-
-  /* if (ws <= 1)
-     result = src;
-     else */
-  if (ws == 2)
-    for (y = 0; y < h; ++y)
-      {
-        // use kernel [1 1] / 2
-        *rptr++ = (sptr[0] + sptr[h]) / 2.0;
-        ++sptr;
-      }
-  else if (ws == 3)
-    for (y = 0; y < h; ++y)
-      {
-        // use kernel [1 2 1] / 4
-        *rptr++ = (sptr[0] + sptr[h] * 2.0 + sptr[h2]) / 4.0;
-        ++sptr;
-      }
-  else // general case for ws >= 4
-    {
-      // left most point - use kernel [10 10 5 1] / 26
-      for (y = 0; y < h; ++y)
-        {
-          *rptr++ = ((sptr[0] + sptr[h]) * 10.0 + 
-		     sptr[h2] * 5.0 + sptr[h3]) / 26.0;
-          ++sptr;
-        }
-      sptr -= h;
-      
-      // general case
-      for (x = 0; x < (ws - 5); x += 2)
-        {
-          for (y = 0; y < h; ++y)
-            {
-              // use kernel [1 5 10 10 5 1] / 32
-              *rptr++ = ((sptr[h]  + sptr[h4])  *  5.0 +
-                         (sptr[h2] + sptr[h3])  * 10.0 +
-                         (sptr[0]  + sptr[h5])) / 32.0;
-              ++sptr;
-            }
-          sptr += h;
-        }
-        
-      // find out how to treat the right most point
-      if (x == (ws - 5))
-        for (y = 0; y < h; ++y)
-          {
-            // use kernel [1 5 10 10 5] / 31
-            *rptr++ = ((sptr[h]  + sptr[h4])  *  5.0 +
-                       (sptr[h2] + sptr[h3])  * 10.0 +
-		       sptr[0]) / 31.0;
-            ++sptr;
-          }
-      else
-        for (y = 0; y < h; ++y)
-          {
-            // use kernel [1 5 10 10] / 26
-            *rptr++ = ( sptr[0]  + sptr[h]   * 5.0 + 
-			(sptr[h2] + sptr[h3]) * 10.0) / 26.0;
-            ++sptr;
-          }
-    }
+	DKLTable::instance().convert(imgR, imgG, imgB, imgL, imgC1, imgC2);
 }
 
 
 
 
-
-
-
-
 // ==============================================================================================================================
 // Contrast sensitivity function. - Not part of original GBVS model -
 
 #ifdef WITH_FFTW
 
 cv::Mat GBVS::applyCSF(const cv::Mat& img1) {
-	if(forward == NULL)
-		forward = new fftwpp::fft2d(img1.cols, img1.rows, -1);
-
-	if(backward == NULL)
-		backward = new fftwpp::fft2d(img1.cols, img1.rows, 1);
-
-
 	cv::Mat imgFloat;
 	img1.convertTo(imgFloat, CV_32FC3);
 
@@ -3025,7 +3196,7 @@ cv::Mat GBVS::applyCSF(const cv::Mat& img1) {
 	cvtColor(imgFloat, imgLab, cv::COLOR_BGR2Lab);
 
 
-	cv::Mat csf = getCSF(imgLab, *forward, *backward);
+	cv::Mat csf = getCSF(imgLab);
 
 
 	cv::Mat result(img1.rows, img1.cols, CV_64FC1, img1.channels());
@@ -3045,45 +3216,39 @@ cv::Mat GBVS::applyCSF(const cv::Mat& img1) {
 
 
 
-cv::Mat GBVS::getCSF(const cv::Mat& img1, fftwpp::fft2d &Forward, fftwpp::fft2d &Backward) const {
+// the luminance goes through real to complex transforms: only the height x (width/2+1) half of the
+// spectrum is stored, the remaining columns being the conjugates of the stored ones.
+cv::Mat GBVS::getCSF(const cv::Mat& img1) const {
 
 	/* get image properties */
 	int width  	  = img1.cols;
 	int height 	  = img1.rows;
 
-	Complex *fft = fftwpp::ComplexAlign(width*height);
-	
-	// Complex *fftCR1, *fftCR2;
-	// fftCR1 = fftwpp::ComplexAlign(width*height);
-	// fftCR2 = fftwpp::ComplexAlign(width*height);
+	double  *signal = fftw_alloc_real(static_cast<size_t>(width) * height);
+	Complex *fft    = reinterpret_cast<Complex*>(fftw_alloc_complex(static_cast<size_t>(height) * (width/2+1)));
 
 	for(int i = 0 ; i < height ; i++ ) {
 		for(int j = 0 ; j < width ; ++j) {
 			const cv::Point3_<float> &ac1c2 = img1.at< cv::Point3_<float> >(i, j);
-			fft[i*width+j] = ac1c2.x;
-			// fftCR1[i*width+j] = ac1c2.y;
-			// fftCR2[i*width+j] = ac1c2.z;
+			signal[i*width+j] = ac1c2.x;
 		}
 	}
 
-	Forward.fft(fft);
-	fftShift(fft, height, width);
+	FFTPlans::forward(width, height, signal, reinterpret_cast<fftw_complex*>(fft));
 	applyAchromaticCSF(fft, height, width);
-
-
-	fftShift(fft, width, height);
-	Backward.fftNormalized(fft);
+	FFTPlans::backward(width, height, reinterpret_cast<fftw_complex*>(fft), signal);
 
 	double mn, mx;
 	cv::Mat globalCSF(img1.rows, img1.cols, CV_32FC1);
 	for(int i = 0 ; i < width*height ; ++i)
-		reinterpret_cast<float*>(globalCSF.data)[i] = static_cast<float>(real(fft[i])); 
+		reinterpret_cast<float*>(globalCSF.data)[i] = static_cast<float>(signal[i] / (width*height)); 
 		
 	cv::minMaxLoc(globalCSF, &mn, &mx);
 	globalCSF = (globalCSF - mn) / (mx - mn);
 
 
-	fftwpp::deleteAlign(fft);
+	fftw_free(signal);
+	fftw_free(fft);
 
 
 	return globalCSF;
@@ -3107,9 +3272,13 @@ void GBVS::applyAchromaticCSF(Complex * fft, int height, int width) const {
 	
 
 
+	// the row u of the half spectrum holds the vertical frequency min(u, height-u), the column j the horizontal frequency j
+	int half = width/2+1;
+
 	float maxSensitivity = 0;
-	for(int i = 0 ; i < height/2 ; ++i) {
-		for(int j = 0 ; j < width/2 ; ++j) {
+	std::vector<float> sensitivity((height/2+1) * half);
+	for(int i = 0 ; i <= height/2 ; ++i) {
+		for(int j = 0 ; j < half ; ++j) {
 			float r2 = nbPixelPerDegree*nbPixelPerDegree*(static_cast<float>(i+1)*static_cast<float>(i+1)/(height*height)
 														 +static_cast<float>(j+1)*static_cast<float>(j+1)/(width*width));
 			float r = std::sqrt(r2);
@@ -3126,17 +3295,15 @@ void GBVS::applyAchromaticCSF(Complex * fft, int height, int width) const {
 
 			if(csf > maxSensitivity) maxSensitivity = csf;
 
-			fft[(height/2+i)*width+(width/2)+j] *= csf;
-			fft[(height/2-i)*width+(width/2)-j] *= csf;
-			fft[(height/2-i)*width+(width/2)+j] *= csf;
-			fft[(height/2+i)*width+(width/2)-j] *= csf;
-
-
+			sensitivity[i*half+j] = csf;
 		}
 	}
 
-	for(int i = 0 ; i < width*height ; ++i) {
-		fft[i] *= peakSensitivity/maxSensitivity;
+	for(int u = 0 ; u < height ; ++u) {
+		const float *csf = &sensitivity[std::min(u, height-u)*half];
+		for(int j = 0 ; j < half ; ++j) {
+			fft[u*half+j] *= csf[j] * peakSensitivity/maxSensitivity;
+		}
 	}
 
 }
@@ -3170,8 +3337,11 @@ void GBVS::applyChromaticCSF(Complex * fft, int height, int width, int color) co
 	}
 	
 
-	for(int i = 0 ; i < height/2 ; ++i) {
-		for(int j = 0 ; j < width/2 ; ++j) {
+	int half = width/2+1;
+
+	for(int u = 0 ; u < height ; ++u) {
+		int i = std::min(u, height-u);
+		for(int j = 0 ; j < half ; ++j) {
 			float r2 = nbPixelPerDegree*nbPixelPerDegree*(static_cast<float>(i+1)*static_cast<float>(i+1)/(height*height)
 														 +static_cast<float>(j+1)*static_cast<float>(j+1)/(width*width));
 			float r = std::sqrt(r2);
@@ -3179,25 +3349,12 @@ void GBVS::applyChromaticCSF(Complex * fft, int height, int width, int color) co
 
 			float csf = peakSensitivity / (1+std::pow(r/a, b))*(1-c*sin(2*theta));
 
-			fft[(height/2+i)*width+(width/2)+j] *= csf;
-			fft[(height/2-i)*width+(width/2)-j] *= csf;
-			fft[(height/2-i)*width+(width/2)+j] *= csf;
-			fft[(height/2+i)*width+(width/2)-j] *= csf;
-
+			fft[u*half+j] *= csf;
 		}
 	}
 
 }
 
-void GBVS::fftShift(Complex * fft, int height, int width) const {
-	for(int i = 0 ; i < height/2 ; ++i) {
-		for(int j = 0 ; j < width/2 ; ++j) {
-			std::swap(fft[i*width+j], fft[width*height/2+width/2+i*width+j]);
-			std::swap(fft[i*width+width/2+j], fft[width*height/2+i*width+j]);
-		}
-	}
-}
-
 #else
 
 cv::Mat GBVS::applyCSF(const cv::Mat& img1) {
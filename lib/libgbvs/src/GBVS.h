@@ -25,10 +25,15 @@
 
 #include <vector>
 #include <list>
+#include <map>
 #include <string>
 #include <opencv2/core.hpp>
 #include <opencv2/objdetect.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "GaborBank.h"
+#include "FeatureTensor.h"
 
 
 //#define WITH_FFTW
@@ -43,7 +48,8 @@ struct FeatureMap {
 	int 		type;
 	int 		level;
 	int 		channel;
-	bool 		taskDone;
+	int 		activationIters;		// products by the markov matrix during the activation and the normalization
+	int 		normalizationIters;
 };
 
 struct Feature {
@@ -54,17 +60,67 @@ struct Feature {
 }; 
 
 
-struct GaborFilter {
-	cv::Mat g0;
-	cv::Mat g90;
+// read-only array, owned by someone else
+template<typename T>
+struct ArrayView {
+	const T 	*ptr;
+	size_t 		 count;
+
+						ArrayView 		() : ptr(NULL), count(0) 					{}
+						ArrayView 		(const T *p, size_t n) : ptr(p), count(n) 	{}
+
+	inline const T& 	operator[] 		(size_t i) const 							{ return ptr[i]; 		}
+	inline size_t 		size 			() const 									{ return count; 		}
+	inline bool 		empty 			() const 									{ return count == 0; 	}
+	inline const T* 	data 			() const 									{ return ptr; 			}
+};
+
+// graph edges stored in compressed sparse row format: the edges of node r are
+// colIdx[rowPtr[r]] ... colIdx[rowPtr[r+1]-1], with their distances in d.
+//
+// The arrays are views: on the arrays given to assign() when the graph is built, or on the memory
+// mapped frame file when the graph is loaded from the disk cache (see FrameCache::read).
+struct SparseGraph {
+	ArrayView<int> 		rowPtr;
+	ArrayView<int> 		colIdx;
+	ArrayView<double> 	d;
+
+						SparseGraph 	() 											{}
+
+	// the graph takes the arrays (they are swapped with empty ones)
+	void 				assign 			(std::vector<int> &rowPtr, std::vector<int> &colIdx, std::vector<double> &d);
+
+private:
+	std::vector<int> 	m_RowPtr;
+	std::vector<int> 	m_ColIdx;
+	std::vector<double> m_D;
+
+	// the views would point to the arrays of the copied graph
+						SparseGraph 	(const SparseGraph &);
+	SparseGraph& 		operator= 		(const SparseGraph &);
+};
+
+// edge weights exp(-d/(2*sig^2)) of a frame for one sigma, dense or sparse like the frame. The single 
+// precision copies (dwf, sparsef) are only filled when the single precision activation asked for them.
+struct EdgeWeights {
+	cv::Mat 			dw;
+	std::vector<double> sparse;
+	cv::Mat 			dwf;
+	std::vector<float> 	sparsef;
 };
 
 struct Frame {
 	cv::Mat lx;
 	cv::Mat d;
-	std::vector< std::pair<int, int> > 	dims;
+	SparseGraph sparse;		// used instead of d when the graph is sparse
+	std::vector< std::pair<int, int> > 	dims;		// the size of dims[0] sets the scale of sigma (see graphsalapply)
 	std::vector<int> 					multilevels;
 
+	boost::shared_ptr<void>				storage;	// memory mapped file holding lx and d, when loaded from the disk cache
+
+	// edge weights already computed for this graph, by sigma. Filled by GBVS::edgeWeights()
+	mutable boost::mutex 				weightsMutex;
+	mutable std::map< double, boost::shared_ptr<const EdgeWeights> > weights;
 };
 
 
@@ -88,8 +144,10 @@ public:
 	float 	linperWeight;
 	float 	faceFeatureWeight;
 	float 	blurFeatureWeight;
+	int 	faceDetectionSize;	// maximum dimension of the grey image given to the face detector, 0 => full resolution
 
 	std::vector<float> 	gaborangles;
+	int 				orientationFilter;	// 0 => fastest method per level, 1 => spatial, 2 => separable, 3 => spectral (see GaborBank)
 	std::vector<float> 	motionAngles;
 	float	contrastwidth;
 	float	flickerNewFrameWt;
@@ -110,6 +168,15 @@ public:
 	int 	normalizationType;
 	int 	normalizeTopChannelMaps;
 
+	bool 	sparseGraph;		// keep only the edges with a weight exp(-d/(2*sig^2)) above sparseCutoff
+	double 	sparseCutoff;
+	int 	graphEngine;		// 1 => the markov matrix is built, 2 => matrix-free markov chain (see MarkovChain)
+	int 	activationBatch;	// number of maps solved together by an activation job (graphEngine 2 only)
+	bool 	singlePrecision;	// run the markov chains in float instead of double (graphEngine 2 only)
+	int 	eigenSolver;		// 1 => power iterations, 2 => power iterations with Aitken extrapolation (graphEngine 2 only)
+	bool 	warmStart;			// the eigenvector iterations start from the map instead of the uniform vector (graphEngine 2 only)
+	bool 	reportIterations;	// print the number of iterations of each map
+
 
 	// CSF parameters
 	bool  useCSF;
@@ -136,42 +203,27 @@ public:
 
 protected:
 
-	std::list<FeatureMap> 		allmaps;
+	std::list<FeatureMap> 		allmaps;			// maps of the activation, views on the tensor
 	cv::Mat 					master_map;
-	std::list<FeatureMap>		channelMaps;
-
+	std::list<FeatureMap>		channelMaps;		// sum of the maps of each channel, views on the channel planes of the tensor
+	FeatureTensor 				activationTensor;
 
-	// internal feature graph-activation
-	Frame 						grframe;
 
-private:
+	// internal feature graph-activation, shared by all the instances using the same graph (see FrameCache)
+	boost::shared_ptr<const Frame> grframe;
 
 	// internal features
 	std::vector<GaborFilter> 	gaborFilters;
-	std::vector<float>          mapWeights;
+	GaborBank 					gaborBank;
 
+private:
 
-	// internal csf variable
-#ifdef WITH_FFTW
-	static int 					 instanceCounter;
-	static fftwpp::fft2d		*forward;
-	static fftwpp::fft2d		*backward;
-#endif
-
+	std::vector<float>          mapWeights;
 
-	boost::mutex 				 gbvs_mutex;
 
 	
 
 
-	bool initCascadeClassifier;
-	bool faceCascadeEnabled;
-	bool eyeCascadeEnabled;
-	cv::CascadeClassifier face_cascade;
-	cv::CascadeClassifier eye_cascade;
-
-
-
 public:
 
 
@@ -192,7 +244,7 @@ public:
 
 
 
-	void computeFeatures	(const cv::Mat &imgBGR);
+	virtual void computeFeatures(const cv::Mat &imgBGR);
 	void gbvsActivation		(const cv::Mat &imgBGR, cv::Mat &out, bool normalize = true);
 
 
@@ -212,7 +264,10 @@ public:
 
 
 protected:
-	void 		graphsalinit		(const std::vector<int> &dims);
+	virtual void graphsalinit		(const std::vector<int> &dims);
+	void 		buildFrame			(const std::vector<int> &dims, Frame &frame) 									const;
+	std::string frameKey			(const std::vector<int> &dims) 													const;
+	virtual std::string distanceModel() 																			const;
 
 
 	// ------------------------------------------------------------------------------------------------
@@ -237,18 +292,33 @@ protected:
 
 
 	virtual cv::Mat simpledistance	(const std::pair<int, int>& dim, int cyclic_type) 								const;
+	virtual double 	nodedistance	(const std::pair<int, int>& dim, int cyclic_type, int a, int b) 				const;
+	virtual int 	nodereach 		(const std::pair<int, int>& dim, int cyclic_type, double maxDistance) 			const;
+	void 		sparseGraphInit		(const std::vector< std::pair<int, int> >& dims, 
+									 const cv::Mat&  lx, 
+									 int cyclic_type, 
+									 double maxDistance, 
+									 SparseGraph &graph) 															const;
 	void 		arrangeLinear 		(const std::vector<cv::Mat> &apyr, const std::vector< std::pair<int, int> > &dims, std::vector<double> &o_datas) const;
 	void 		assignWeights		(const std::vector<double>& AL, const cv::Mat& dw, cv::Mat &mm, int algtype) 	const;
 	void 		columnNormalize		(cv::Mat &mm) 																	const;
 	void 		principalEigenvectorRaw(const cv::Mat& markovA, float tol, std::vector<double>& AL, int &iteri) 	const ;
 	float 		sparseness 			(const cv::Mat& markovA) 														const;
+
+	void 		assignWeightsSparse	(const std::vector<double>& AL, const SparseGraph& graph, const std::vector<double>& dw, std::vector<double> &mm, int algtype) const;
+	void 		columnNormalizeSparse(const SparseGraph& graph, std::vector<double> &mm) 								const;
+	void 		principalEigenvectorSparse(const SparseGraph& graph, const std::vector<double>& markovA, float tol, std::vector<double>& AL, int &iteri) const;
 	void 		sumOverScales		(std::vector<double> &A, const cv::Mat &lx, int size, std::vector<double> &vo) 	const;
 	
 
 
 
 
-	cv::Mat 	graphsalapply 		(const cv::Mat &A, const Frame& frame, float sigma_frac, int num_iters, int algtype, float tol) const;
+	cv::Mat 	graphsalapply 		(const cv::Mat &A, const Frame& frame, float sigma_frac, int num_iters, int algtype, float tol, int *iterations = NULL) const;
+	void 		graphsalapplyBatch	(const std::vector<cv::Mat*> &maps, const Frame& frame, float sigma_frac, int num_iters, int algtype, float tol, std::vector<int> *iterations = NULL) const;
+	void 		graphsalnodes		(const cv::Mat &A, const Frame& frame, std::vector<double> &AL) 				const;
+	void 		graphsalmap			(std::vector<double> &AL, const Frame& frame, int rows, int cols, cv::Mat &result) const;
+	boost::shared_ptr<const EdgeWeights> edgeWeights(const Frame& frame, double sig, bool single = false) 		const;
 
 
 
@@ -264,10 +334,11 @@ protected:
 	void 		rgb2dkl 			(cv::Mat &imgR, cv::Mat &imgG, cv::Mat &imgB, cv::Mat &imgL, cv::Mat &imgC1, cv::Mat &imgC2) const;
 	cv::Mat 	safeDivideGBVS 		(const cv::Mat &u, const cv::Mat &v) 		const;
 	cv::Mat 	contrast 			(const cv::Mat &img, int size) 				const;
-	cv::Mat 	subsample 			(const cv::Mat& img) 						const;
+	virtual cv::Mat subsample		(const cv::Mat& img) 						const;
+	virtual void orientationEnergies(const cv::Mat& img, std::vector<cv::Mat> &energies) const;	// energies of the Gabor bank on a pyramid level
 
 	cv::Mat 	defocusBlurMap 		(const cv::Mat& image)						const;
-	cv::Mat 	faceFeaturesDectection(const cv::Mat& image);
+	cv::Mat 	faceFeaturesDectection(const cv::Mat& image)					const;
 	Feature 	segmentationFeature (const cv::Mat& image) 						const;
 	
 	
@@ -276,7 +347,18 @@ protected:
 	cv::Mat 	getUCharImageC1 	(const cv::Mat &input) 						const;
 	void 		getFeatureMaps		(const cv::Mat& img);
 
-	void 		getPerspectiveFeatureJob(const cv::Mat& img, cv::Mat &output, double *reliability) const;
+	// pyramids shared by the feature extraction tasks
+	struct Pyramids {
+		cv::Mat 				imgi;		// intensity, or luminance filtered by the CSF
+		std::vector<cv::Mat> 	L, R, G, B;
+	};
+
+	void 		getLuminancePyramidJob	(const cv::Mat& img, const cv::Mat& imgi, Pyramids &pyr);
+	void 		getPyramidJob 			(const cv::Mat& img, std::vector<cv::Mat> &pyramid, int depth) 				const;
+	void 		getChannelLevelJob 		(char channel, int lev, const Pyramids &pyr, std::list<FeatureMap> &maps) 	const;
+	void 		getDKLJob 				(const Pyramids &pyr, Feature &f) 											const;
+	void 		getChannelJob 			(char channel, const cv::Mat& img, const Pyramids &pyr, Feature &f, char &produced);
+	void 		getPerspectiveFeatureJob(const cv::Mat& img, std::vector<cv::Mat> &outputs, std::vector<double> &reliability, int i) const;
 
 
 
@@ -289,11 +371,16 @@ protected:
 
 
 	void 		computeActivation	();
-	void 		computeActivationJob();
+	void 		computeActivationJob(const std::vector<FeatureMap*> &maps, int task);
 	void		normalizeActivation	();
-	void 		normalizeActivationJob();
+	void 		normalizeActivationJob(const std::vector<FeatureMap*> &maps, int task);
+	int 		activationTasks		(std::vector<FeatureMap*> &maps, int batch);
+	int 		activationBatchSize	() 												const;
+	int 		normalizationBatchSize() 											const;
+	void 		printIterations		() 												const;
 	void 		averageByFeatureChannel();
 	void		sumChannels			(bool normalize);
+	virtual void renderMasterMap	()												{}	// master map of a graph which is not an image
 	void 		blurMasterMap		(bool normalize);
 
 
@@ -325,8 +412,6 @@ protected:
 	cv::Mat 	transpose 			(const cv::Mat& input) 						const;
 	virtual void attenuateBordersGBVS(cv::Mat &map, int borderSize) 			const;
 
-	void 		lowPass6yDecY 		(double* sptr, double* rptr, int w, int hs) const;
-	void 		lowPass6xDecX 		(double* sptr, double* rptr, int ws, int h) const;
 
 
 
@@ -341,10 +426,9 @@ protected:
 
 #ifdef WITH_FFTW
 
-	cv::Mat 	getCSF				(const cv::Mat& img1, fftwpp::fft2d &Forward, fftwpp::fft2d &Backward) 	const;
+	cv::Mat 	getCSF				(const cv::Mat& img1) 								const;
 	void	 	applyAchromaticCSF	(Complex * fft, int height, int width) 				const;
 	void 		applyChromaticCSF 	(Complex * fft, int height, int width, int color) 	const;
-	void  		fftShift 			(Complex * fft, int height, int width) 				const;
 
 #endif
 
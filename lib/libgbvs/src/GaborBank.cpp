@@ -0,0 +1,260 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#include "GaborBank.h"
+
+#include <cmath>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+
+const double GaborBank::separableTolerance = 1e-7;
+
+
+GaborBank::GaborBank() : m_Top(0), m_Bottom(0), m_Left(0), m_Right(0), m_Cache(new SpectraCache()) {
+}
+
+
+
+void GaborBank::set(const std::vector<GaborFilter> &filters) {
+	m_Filters = filters;
+	m_Separable.clear();
+	m_Top = m_Bottom = m_Left = m_Right = 0;
+
+	for(size_t o = 0 ; o < m_Filters.size() ; ++o) {
+		const cv::Mat *kernels[2] = { &m_Filters[o].g0, &m_Filters[o].g90 };
+
+		for(int k = 0 ; k < 2 ; ++k) {
+			const cv::Mat &kernel = *kernels[k];
+
+			// anchor of cv::filter2D for the point (-1,-1): center of the kernel
+			m_Top 	 = std::max(m_Top, kernel.rows / 2);
+			m_Bottom = std::max(m_Bottom, kernel.rows - 1 - kernel.rows / 2);
+			m_Left 	 = std::max(m_Left, kernel.cols / 2);
+			m_Right  = std::max(m_Right, kernel.cols - 1 - kernel.cols / 2);
+
+			m_Separable.push_back(decompose(kernel));
+		}
+	}
+
+	// the spectra depend on the kernels
+	m_Cache.reset(new SpectraCache());
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// choice of the method
+
+
+cv::Size GaborBank::transformSize(const cv::Size &size) const {
+	return cv::Size(cv::getOptimalDFTSize(size.width + m_Left + m_Right), cv::getOptimalDFTSize(size.height + m_Top + m_Bottom));
+}
+
+
+int GaborBank::method(const cv::Size &size) const {
+	if(m_Filters.empty())
+		return Spatial;
+
+	double area = static_cast<double>(size.width) * size.height;
+
+	// multiply-adds of the filters
+	double spatial = 0;
+	double separable = 0;
+	for(size_t o = 0 ; o < m_Filters.size() ; ++o) {
+		spatial += static_cast<double>(m_Filters[o].g0.total() + m_Filters[o].g90.total()) * area;
+	}
+	for(size_t k = 0 ; k < m_Separable.size() ; ++k) {
+		for(size_t r = 0 ; r < m_Separable[k].rows.size() ; ++r) {
+			separable += static_cast<double>(m_Separable[k].rows[r].total() + m_Separable[k].columns[r].total() + 1) * area;
+		}
+	}
+
+	// ~ 5 N log2(N) flops per complex transform (half of it for the real forward one), 4 flops per 
+	// multiply-add.
+	cv::Size dft = transformSize(size);
+	double n = static_cast<double>(dft.width) * dft.height;
+	double fft = 5 * n * std::log2(n);
+	double spectral = (fft / 2 + m_Filters.size() * (fft + 6 * n + 2 * area)) / 4;
+
+	if(spectral <= separable && spectral <= spatial)
+		return Spectral;
+	if(separable < spatial)
+		return Separable;
+	return Spatial;
+}
+
+
+
+void GaborBank::apply(const cv::Mat &img, std::vector<cv::Mat> &energies, int method) const {
+	energies.resize(m_Filters.size());
+	if(m_Filters.empty())
+		return;
+
+	if(method == Automatic)
+		method = this->method(img.size());
+
+	switch(method) {
+		case Separable:
+			applySeparable(img, energies);
+			break;
+
+		case Spectral:
+			applySpectral(img, energies);
+			break;
+
+		default:
+			applySpatial(img, energies);
+			break;
+	}
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// spatial filtering
+
+
+void GaborBank::applySpatial(const cv::Mat &img, std::vector<cv::Mat> &energies) const {
+	for(size_t o = 0 ; o < m_Filters.size() ; ++o) {
+		cv::Mat f0, f90;
+		cv::filter2D(img, f0, CV_64F,  m_Filters[o].g0,  cv::Point(-1, -1), 0, cv::BORDER_DEFAULT );
+		cv::filter2D(img, f90, CV_64F, m_Filters[o].g90, cv::Point(-1, -1), 0, cv::BORDER_DEFAULT );
+
+		energies[o] = cv::abs(f0) + cv::abs(f90);
+	}
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// separable filtering
+
+
+GaborBank::SeparableKernel GaborBank::decompose(const cv::Mat &kernel) {
+	cv::Mat w, u, vt;
+	cv::SVD::compute(kernel, w, u, vt);
+
+	double total = 0;
+	for(int r = 0 ; r < w.rows ; ++r) {
+		total += w.at<double>(r) * w.at<double>(r);
+	}
+
+	// keep the singular values until the residual energy is below the tolerance
+	SeparableKernel result;
+	double residual = total;
+	for(int r = 0 ; r < w.rows && residual > separableTolerance * separableTolerance * total ; ++r) {
+		double s = std::sqrt(w.at<double>(r));
+		result.columns.push_back(u.col(r) * s);
+		result.rows.push_back(vt.row(r) * s);
+
+		residual -= w.at<double>(r) * w.at<double>(r);
+	}
+
+	return result;
+}
+
+
+cv::Mat GaborBank::filter(const cv::Mat &img, const SeparableKernel &kernel) {
+	cv::Mat result = cv::Mat::zeros(img.rows, img.cols, CV_64FC1);
+
+	// the reflected borders are separable: each term gives the response of cv::filter2D to its rank-1 kernel
+	for(size_t r = 0 ; r < kernel.rows.size() ; ++r) {
+		cv::Mat term;
+		cv::sepFilter2D(img, term, CV_64F, kernel.rows[r], kernel.columns[r], cv::Point(-1, -1), 0, cv::BORDER_DEFAULT);
+		result += term;
+	}
+
+	return result;
+}
+
+
+void GaborBank::applySeparable(const cv::Mat &img, std::vector<cv::Mat> &energies) const {
+	for(size_t o = 0 ; o < m_Filters.size() ; ++o) {
+		energies[o] = cv::abs(filter(img, m_Separable[2*o])) + cv::abs(filter(img, m_Separable[2*o+1]));
+	}
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// spectral filtering
+
+
+// spectrum of g0 + i g90, flipped and shifted such that the circular convolution with the padded level 
+// gives the correlation of cv::filter2D at the top left corner.
+boost::shared_ptr<const GaborBank::Spectra> GaborBank::spectra(const cv::Size &dftSize) const {
+	boost::mutex::scoped_lock lock(m_Cache->mutex);
+
+	boost::shared_ptr<const Spectra> &entry = m_Cache->spectra[std::make_pair(dftSize.height, dftSize.width)];
+	if(entry)
+		return entry;
+
+	boost::shared_ptr<Spectra> result(new Spectra(m_Filters.size()));
+	for(size_t o = 0 ; o < m_Filters.size() ; ++o) {
+		const cv::Mat *kernels[2] = { &m_Filters[o].g0, &m_Filters[o].g90 };
+
+		cv::Mat kernel = cv::Mat::zeros(dftSize.height, dftSize.width, CV_64FC2);
+		for(int k = 0 ; k < 2 ; ++k) {
+			const cv::Mat &g = *kernels[k];
+
+			for(int i = 0 ; i < g.rows ; ++i) {
+				int si = (dftSize.height - (i - g.rows / 2 + m_Top)) % dftSize.height;
+				for(int j = 0 ; j < g.cols ; ++j) {
+					int sj = (dftSize.width - (j - g.cols / 2 + m_Left)) % dftSize.width;
+					kernel.at<cv::Vec2d>(si, sj)[k] = g.at<double>(i, j);
+				}
+			}
+		}
+
+		cv::dft(kernel, (*result)[o]);
+	}
+
+	entry = result;
+	return entry;
+}
+
+
+void GaborBank::applySpectral(const cv::Mat &img, std::vector<cv::Mat> &energies) const {
+	cv::Size dftSize = transformSize(img.size());
+
+	cv::Mat padded = cv::Mat::zeros(dftSize.height, dftSize.width, CV_64FC1);
+	cv::Mat bordered = padded(cv::Rect(0, 0, img.cols + m_Left + m_Right, img.rows + m_Top + m_Bottom));
+	cv::copyMakeBorder(img, bordered, m_Top, m_Bottom, m_Left, m_Right, cv::BORDER_DEFAULT);
+
+	cv::Mat spectrum;
+	cv::dft(padded, spectrum, cv::DFT_COMPLEX_OUTPUT);
+
+	boost::shared_ptr<const Spectra> kernels = spectra(dftSize);
+	cv::Rect roi(0, 0, img.cols, img.rows);
+
+	for(size_t o = 0 ; o < m_Filters.size() ; ++o) {
+		cv::Mat product, response;
+		cv::mulSpectrums(spectrum, (*kernels)[o], product, 0);
+		cv::dft(product, response, cv::DFT_INVERSE | cv::DFT_SCALE);
+
+		// real part: response to g0, imaginary part: response to g90
+		std::vector<cv::Mat> parts;
+		cv::split(response(roi), parts);
+		energies[o] = cv::abs(parts[0]) + cv::abs(parts[1]);
+	}
+}
@@ -0,0 +1,112 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _GABORBANK_
+#define _GABORBANK_
+
+#include <map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+struct GaborFilter {
+	cv::Mat g0;
+	cv::Mat g90;
+};
+
+
+// Orientation channel: filters a pyramid level with every quadrature pair of the bank, and returns the
+// energies |g0 * img| + |g90 * img|, with the border handling of cv::filter2D (BORDER_DEFAULT).
+//
+// Three methods give the same responses:
+//  - spatial:   cv::filter2D with each kernel (two per orientation),
+//  - separable: each kernel is replaced by its rank-r SVD decomposition, truncated when the residual
+//               energy is below separableTolerance, and applied with cv::sepFilter2D. It only pays for the
+//               kernels with a small rank (the 0 and 90 degrees gabors are rank 2),
+//  - spectral:  the level is padded and transformed once, and each orientation costs one complex
+//               product and one inverse transform: g0 and g90 are packed as the real and imaginary parts
+//               of a single kernel, so the inverse gives both responses. The spectra of the kernels are
+//               computed once per transform size.
+//
+// The automatic method picks the cheapest one for the size of the level from an operation count.
+
+class GaborBank {
+
+public:
+
+	enum Method { Automatic = 0, Spatial = 1, Separable = 2, Spectral = 3 };
+
+	static const double 	separableTolerance;
+
+						 GaborBank 		();
+
+	void 				set 			(const std::vector<GaborFilter> &filters);
+	size_t 				size 			() const 				{ return m_Filters.size(); }
+
+	void 				apply 			(const cv::Mat &img, std::vector<cv::Mat> &energies, int method = Automatic) const;
+
+	// cheapest method for a level of the given size
+	int 				method 			(const cv::Size &size) const;
+
+
+private:
+
+	// kernel ~= sum_r columns[r] * rows[r]
+	struct SeparableKernel {
+		std::vector<cv::Mat> columns;
+		std::vector<cv::Mat> rows;
+	};
+
+	typedef std::vector<cv::Mat> 	Spectra;
+
+	struct SpectraCache {
+		boost::mutex 												mutex;
+		std::map< std::pair<int,int>, boost::shared_ptr<const Spectra> > spectra;
+	};
+
+	void 				applySpatial 	(const cv::Mat &img, std::vector<cv::Mat> &energies) const;
+	void 				applySeparable 	(const cv::Mat &img, std::vector<cv::Mat> &energies) const;
+	void 				applySpectral 	(const cv::Mat &img, std::vector<cv::Mat> &energies) const;
+
+	static SeparableKernel 	decompose 	(const cv::Mat &kernel);
+	static cv::Mat 			filter 		(const cv::Mat &img, const SeparableKernel &kernel);
+
+	cv::Size 			transformSize 	(const cv::Size &size) const;
+	boost::shared_ptr<const Spectra> spectra (const cv::Size &dftSize) const;
+
+
+	std::vector<GaborFilter> 			m_Filters;
+	std::vector<SeparableKernel> 		m_Separable;	// g0, g90 of each filter
+
+	// largest extent of the kernels around their anchor: the level is padded by these margins
+	int 								m_Top;
+	int 								m_Bottom;
+	int 								m_Left;
+	int 								m_Right;
+
+	boost::shared_ptr<SpectraCache> 	m_Cache;
+};
+
+
+#endif
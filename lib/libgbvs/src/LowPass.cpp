@@ -0,0 +1,237 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#include "LowPass.h"
+
+#include <vector>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define LOWPASS_SSE2
+#endif
+
+
+
+// ------------------------------------------------------------------------------------------------
+// horizontal pass: one row of n samples, decimated to max(1, n/2) samples
+
+
+static void lowPass6DecRow(const double *s, double *r, int n) {
+
+	if (n == 1) {
+		r[0] = s[0];
+		return;
+	}
+
+	if (n == 2) {
+		// use kernel [1 1] / 2
+		r[0] = (s[0] + s[1]) / 2.0;
+		return;
+	}
+
+	if (n == 3) {
+		// use kernel [1 2 1] / 4
+		r[0] = (s[0] + s[1] * 2.0 + s[2]) / 4.0;
+		return;
+	}
+
+	// left most point - use kernel [10 10 5 1] / 26
+	*r++ = ((s[0] + s[1]) * 10.0 + s[2] * 5.0 + s[3]) / 26.0;
+
+	int x = 0;
+
+#ifdef LOWPASS_SSE2
+	// two outputs per iteration: the taps of x and x+2 are deinterleaved from 4 loads
+	const __m128d five 	= _mm_set1_pd(5.0);
+	const __m128d ten 	= _mm_set1_pd(10.0);
+	const __m128d scale = _mm_set1_pd(1.0 / 32.0);
+
+	for ( ; x + 2 < n - 5 ; x += 4) {
+		__m128d a0 = _mm_loadu_pd(s + x);
+		__m128d a1 = _mm_loadu_pd(s + x + 2);
+		__m128d a2 = _mm_loadu_pd(s + x + 4);
+		__m128d a3 = _mm_loadu_pd(s + x + 6);
+
+		__m128d s0 = _mm_unpacklo_pd(a0, a1);
+		__m128d s1 = _mm_unpackhi_pd(a0, a1);
+		__m128d s2 = _mm_unpacklo_pd(a1, a2);
+		__m128d s3 = _mm_unpackhi_pd(a1, a2);
+		__m128d s4 = _mm_unpacklo_pd(a2, a3);
+		__m128d s5 = _mm_unpackhi_pd(a2, a3);
+
+		__m128d v = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_add_pd(s1, s4), five), 
+										  _mm_mul_pd(_mm_add_pd(s2, s3), ten)), 
+							   _mm_add_pd(s0, s5));
+
+		// the scaling by a power of two is exact: same result as the division
+		_mm_storeu_pd(r, _mm_mul_pd(v, scale));
+		r += 2;
+	}
+#endif
+
+	// general case - use kernel [1 5 10 10 5 1] / 32
+	for ( ; x < n - 5 ; x += 2) {
+		*r++ = ((s[x+1] + s[x+4]) *  5.0 +
+				(s[x+2] + s[x+3]) * 10.0 +
+				(s[x]   + s[x+5])) / 32.0;
+	}
+
+	// right most point
+	if (x == n - 5) {
+		// use kernel [1 5 10 10 5] / 31
+		*r = ((s[x+1] + s[x+4]) *  5.0 +
+			  (s[x+2] + s[x+3]) * 10.0 +
+			  s[x]) / 31.0;
+	} else {
+		// use kernel [1 5 10 10] / 26
+		*r = (s[x] + s[x+1] * 5.0 + (s[x+2] + s[x+3]) * 10.0) / 26.0;
+	}
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// vertical pass: combination of whole rows
+
+
+// r = ((r1 + r4) * 5 + (r2 + r3) * 10 + (r0 + r5)) / 32
+static void lowPass6Rows(const double *const *s, double *r, int n) {
+	int i = 0;
+
+#if defined(__AVX__)
+	{
+		const __m256d five 	= _mm256_set1_pd(5.0);
+		const __m256d ten 	= _mm256_set1_pd(10.0);
+		const __m256d scale = _mm256_set1_pd(1.0 / 32.0);
+
+		for ( ; i + 4 <= n ; i += 4) {
+			__m256d v = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(_mm256_loadu_pd(s[1] + i), _mm256_loadu_pd(s[4] + i)), five),
+													_mm256_mul_pd(_mm256_add_pd(_mm256_loadu_pd(s[2] + i), _mm256_loadu_pd(s[3] + i)), ten)),
+									  _mm256_add_pd(_mm256_loadu_pd(s[0] + i), _mm256_loadu_pd(s[5] + i)));
+			_mm256_storeu_pd(r + i, _mm256_mul_pd(v, scale));
+		}
+	}
+#endif
+
+#ifdef LOWPASS_SSE2
+	{
+		const __m128d five 	= _mm_set1_pd(5.0);
+		const __m128d ten 	= _mm_set1_pd(10.0);
+		const __m128d scale = _mm_set1_pd(1.0 / 32.0);
+
+		for ( ; i + 2 <= n ; i += 2) {
+			__m128d v = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_loadu_pd(s[1] + i), _mm_loadu_pd(s[4] + i)), five),
+											  _mm_mul_pd(_mm_add_pd(_mm_loadu_pd(s[2] + i), _mm_loadu_pd(s[3] + i)), ten)),
+								   _mm_add_pd(_mm_loadu_pd(s[0] + i), _mm_loadu_pd(s[5] + i)));
+			_mm_storeu_pd(r + i, _mm_mul_pd(v, scale));
+		}
+	}
+#endif
+
+	for ( ; i < n ; ++i) {
+		r[i] = ((s[1][i] + s[4][i]) *  5.0 +
+				(s[2][i] + s[3][i]) * 10.0 +
+				(s[0][i] + s[5][i])) / 32.0;
+	}
+}
+
+
+
+void lowPass6Dec(const cv::Mat &src, cv::Mat &dst) {
+	int w = src.cols;
+	int h = src.rows;
+	int wr = w / 2; if ( wr == 0 ) wr = 1;
+	int hr = h / 2; if ( hr == 0 ) hr = 1;
+
+	// horizontal pass
+	cv::Mat decx(h, wr, CV_64FC1);
+	for(int y = 0 ; y < h ; ++y) {
+		lowPass6DecRow(src.ptr<double>(y), decx.ptr<double>(y), w);
+	}
+
+	// vertical pass
+	dst.create(hr, wr, CV_64FC1);
+
+	if (h == 1) {
+		decx.copyTo(dst);
+		return;
+	}
+
+	if (h == 2) {
+		// use kernel [1 1]^T / 2
+		const double *s0 = decx.ptr<double>(0), *s1 = decx.ptr<double>(1);
+		double *r = dst.ptr<double>(0);
+		for(int x = 0 ; x < wr ; ++x)
+			r[x] = (s0[x] + s1[x]) / 2.0;
+		return;
+	}
+
+	if (h == 3) {
+		// use kernel [1 2 1]^T / 4
+		const double *s0 = decx.ptr<double>(0), *s1 = decx.ptr<double>(1), *s2 = decx.ptr<double>(2);
+		double *r = dst.ptr<double>(0);
+		for(int x = 0 ; x < wr ; ++x)
+			r[x] = (s0[x] + s1[x] * 2.0 + s2[x]) / 4.0;
+		return;
+	}
+
+	// top most point - use kernel [10 10 5 1]^T / 26
+	{
+		const double *s0 = decx.ptr<double>(0), *s1 = decx.ptr<double>(1), *s2 = decx.ptr<double>(2), *s3 = decx.ptr<double>(3);
+		double *r = dst.ptr<double>(0);
+		for(int x = 0 ; x < wr ; ++x)
+			r[x] = ((s0[x] + s1[x]) * 10.0 + s2[x] * 5.0 + s3[x]) / 26.0;
+	}
+
+	// general case - use kernel [1 5 10 10 5 1]^T / 32
+	int y = 0;
+	int yr = 1;
+	for ( ; y < h - 5 ; y += 2, ++yr) {
+		const double *rows[6];
+		for(int k = 0 ; k < 6 ; ++k)
+			rows[k] = decx.ptr<double>(y + k);
+
+		lowPass6Rows(rows, dst.ptr<double>(yr), wr);
+	}
+
+	// bottom most point
+	{
+		const double *s0 = decx.ptr<double>(y), *s1 = decx.ptr<double>(y+1), *s2 = decx.ptr<double>(y+2), *s3 = decx.ptr<double>(y+3);
+		double *r = dst.ptr<double>(yr);
+
+		if (y == h - 5) {
+			// use kernel [1 5 10 10 5]^T / 31
+			const double *s4 = decx.ptr<double>(y+4);
+			for(int x = 0 ; x < wr ; ++x)
+				r[x] = ((s1[x] + s4[x]) *  5.0 +
+						(s2[x] + s3[x]) * 10.0 +
+						s0[x]) / 31.0;
+		} else {
+			// use kernel [1 5 10 10]^T / 26
+			for(int x = 0 ; x < wr ; ++x)
+				r[x] = (s0[x] + s1[x] * 5.0 + (s2[x] + s3[x]) * 10.0) / 26.0;
+		}
+	}
+}
@@ -0,0 +1,46 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _LOWPASS_
+#define _LOWPASS_
+
+#include <opencv2/core.hpp>
+
+
+// Decimating low-pass of the pyramids: kernel [1 5 10 10 5 1] / 32 applied along the rows and then
+// along the columns, keeping one sample out of two (the borders use the truncated kernels of the
+// original MEX code: [10 10 5 1] / 26 on the first sample, [1 5 10 10 5] / 31 or [1 5 10 10] / 26 on
+// the last one).
+//
+// The image is processed in its OpenCV row order, without transposition. The vertical pass combines
+// whole rows and is vectorized with AVX or SSE2, the horizontal pass deinterleaves the even and odd 
+// samples with SSE2. There is a scalar fallback when none is available. The arithmetic is done in the 
+// same order as the MEX code, so the output is bit-identical to it unless the compiler contracts the 
+// scalar code into FMA instructions (-mfma with -ffp-contract=fast), in which case the two differ
+// by a few ulps.
+//
+// src: CV_64FC1, dst: (max(1, rows/2), max(1, cols/2)) CV_64FC1.
+
+void lowPass6Dec 	(const cv::Mat &src, cv::Mat &dst);
+
+
+#endif
@@ -0,0 +1,189 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+#ifndef _MARKOVCHAIN_
+#define _MARKOVCHAIN_
+
+#include <vector>
+
+struct SparseGraph;
+
+
+// running sum of the solvers. In single precision the sums over the N nodes lose too many digits,
+// so they are Kahan-compensated. step() is the same update on a sum and a compensation held by the 
+// caller, so that several sums can be laid out as arrays (see LaneSummation).
+template<typename T>
+struct Summation {
+	T 					sum;
+
+						Summation 		() : sum(0) 							{}
+	inline void 		add 			(T x) 									{ sum += x; }
+	inline T 			value 			() const 								{ return sum; }
+
+	static inline void 	step 			(T &sum, T &, T x) 						{ sum += x; }
+};
+
+template<>
+struct Summation<float> {
+	float 				sum;
+	float 				comp;
+
+						Summation 		() : sum(0), comp(0) 					{}
+	inline void 		add 			(float x) 								{ step(sum, comp, x); }
+	inline float 		value 			() const 								{ return sum; }
+
+	static inline void 	step 			(float &sum, float &comp, float x) 		{ float y = x - comp; float t = sum + y; comp = (t - sum) - y; sum = t; }
+};
+
+
+// Summation of a row split on Lanes independent sums, element j of each block of Lanes elements going
+// to the lane j. The lanes do not depend on each other, so that the compensated updates of a block are
+// done with SIMD instructions (8 floats fill an AVX register).
+template<typename T>
+struct LaneSummation {
+	enum { Lanes = 8 };
+
+	T 					sum[Lanes];
+	T 					comp[Lanes];
+
+						LaneSummation 	() 										{ for(int j = 0 ; j < Lanes ; ++j) sum[j] = comp[j] = 0; }
+	inline void 		add 			(const T *x) 							{ for(int j = 0 ; j < Lanes ; ++j) Summation<T>::step(sum[j], comp[j], x[j]); }
+
+	// the lanes are added with their compensation
+	inline T 			value 			() const 								{ Summation<T> s; for(int j = 0 ; j < Lanes ; ++j) { s.add(sum[j]); s.add(-comp[j]); } return s.value(); }
+};
+
+
+// Markov matrix of the GBVS graph, M(r,c) = w(r,c) * f(AL[r],AL[c]) / colsum[c], applied without being
+// stored: this is the matrix built by GBVS::assignWeights and GBVS::columnNormalize. f depends on algtype
+// (see assignWeights). Only O(N) memory is used on top of the edge weights, which are shared.
+//
+// The edge weights are symmetric (the distances are), so the column sums are computed along the rows
+// and the weights are always read row by row.
+
+template<typename T>
+class MarkovChain {
+
+private:
+	const T 			*m_Weights;		// dense: row major with m_Stride elements per row, sparse: one weight per stored edge
+	const SparseGraph 	*m_Graph;		// NULL for a dense graph
+	const T 			*m_AL;
+	int 				 m_Size;
+	int 				 m_Stride;
+	int 				 m_Algtype;
+
+	std::vector<T> 		 m_Colsum;
+	mutable std::vector<T> m_Tmp;
+
+
+public:
+						MarkovChain 	(const T *weights, int stride, const std::vector<T> &AL, int algtype);
+						MarkovChain 	(const SparseGraph &graph, const T *weights, const std::vector<T> &AL, int algtype);
+
+	inline int 			size 			() const 								{ return m_Size; }
+
+	// out = M * v
+	void 				apply 			(const T *v, T *out) 					const;
+
+	// f(AL[r],AL[c]) of assignWeights
+	static inline T 	edgeFactor 		(int algtype, T ar, T ac);
+
+
+private:
+	void 				columnSums 		();
+
+	// out[r] = sum_c w(r,c) * f(AL[r],AL[c]) * u[c]
+	void 				rowProducts 	(const T *u, T *out) 					const;
+	void 				rowProductsDense(const T *u, T *out) 					const;
+	void 				rowProductsSparse(const T *u, T *out) 					const;
+
+	// x[i] = w[i] * f(ar,AL[c+i]) * u[c+i] for i in [0, n), without AL[r] for algtype 1 (applied once per row)
+	inline void 		products 		(const T *w, T ar, int c, int n, const T *u, T *x) const;
+};
+
+
+// computes the principal eigenvector of the Markov matrix, same iterations as GBVS::principalEigenvectorRaw.
+// With warmStart, the iterations start from AL (normalized) instead of the uniform vector.
+template<typename T>
+void principalEigenvector(const MarkovChain<T> &markov, double tol, std::vector<T> &AL, int &iteri, bool warmStart = false);
+
+// same, with a periodic Aitken extrapolation of the iterates. The iterates are normalized, and the
+// iterations stop when no node moves by more than tol.
+template<typename T>
+void principalEigenvectorExtrapolated(const MarkovChain<T> &markov, double tol, std::vector<T> &AL, int &iteri, bool warmStart = false);
+
+
+
+
+// K Markov chains sharing the same graph and edge weights (one per feature map), applied together: each
+// weight is read once for the K maps. The vectors are interleaved, element k of node c is at c*K+k.
+// The chains which have converged are retired, so that the others keep iterating on a smaller batch.
+
+template<typename T>
+class BatchedMarkovChain {
+
+private:
+	const T 			*m_Weights;
+	const SparseGraph 	*m_Graph;
+	int 				 m_Size;
+	int 				 m_Stride;
+	int 				 m_Batch;
+	int 				 m_Active;		// the chains [0, m_Active) are still iterating
+	int 				 m_Algtype;
+
+	std::vector<T> 		 m_AL;
+	std::vector<T> 		 m_Colsum;
+	mutable std::vector<T> m_Tmp;
+	mutable std::vector<T> m_Sum;		// running sums of the active chains, and their compensation (see Summation::step)
+	mutable std::vector<T> m_Comp;
+
+
+public:
+						BatchedMarkovChain 	(const T *weights, int stride, const std::vector< std::vector<T>* > &AL, int algtype);
+						BatchedMarkovChain 	(const SparseGraph &graph, const T *weights, const std::vector< std::vector<T>* > &AL, int algtype);
+
+	inline int 			size 				() const 							{ return m_Size; 	}
+	inline int 			batch 				() const 							{ return m_Batch; 	}
+	inline int 			active 				() const 							{ return m_Active;	}
+
+	// out = M_k * v_k, for all the active chains k
+	void 				apply 				(const T *v, T *out) 				const;
+
+	// exchange the chain k with the last active one, which is then removed from the batch
+	void 				retire 				(int k);
+
+
+private:
+	void 				init 				(const std::vector< std::vector<T>* > &AL);
+	void 				rowProducts 		(const T *u, T *out) 				const;
+	void 				accumulate 			(T w, const T *ar, const T *ac, const T *uc, T *sum, T *comp) const;
+};
+
+
+// principal eigenvectors of all the chains of the batch. Each chain follows the iterations of
+// principalEigenvector(), and iteri receives the number of iterations of each of them.
+template<typename T>
+void principalEigenvectors(BatchedMarkovChain<T> &markov, double tol, std::vector< std::vector<T>* > &AL, std::vector<int> &iteri, bool warmStart = false);
+
+
+#include "MarkovChain.hpp"
+
+
+#endif
@@ -0,0 +1,600 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+#include "GBVS.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+template<typename T>
+MarkovChain<T>::MarkovChain(const T *weights, int stride, const std::vector<T> &AL, int algtype) :
+	m_Weights(weights), m_Graph(NULL), m_AL(&AL[0]), m_Size(static_cast<int>(AL.size())), m_Stride(stride), m_Algtype(algtype) {
+
+	columnSums();
+}
+
+
+template<typename T>
+MarkovChain<T>::MarkovChain(const SparseGraph &graph, const T *weights, const std::vector<T> &AL, int algtype) :
+	m_Weights(weights), m_Graph(&graph), m_AL(&AL[0]), m_Size(static_cast<int>(graph.rowPtr.size())-1), m_Stride(0), m_Algtype(algtype) {
+
+	columnSums();
+}
+
+
+
+template<typename T>
+inline T MarkovChain<T>::edgeFactor(int algtype, T ar, T ac) {
+	switch(algtype) {
+		case 1:  return ar;
+		case 2:  return std::abs( ar - ac );
+		case 3:  return std::abs( std::log( ar/ac ) );
+		case 4:  return static_cast<T>(1.f / (std::abs( ar - ac )+1e-12));
+		default: return 0;
+	}
+}
+
+
+
+// colsum[c] = sum_r w(r,c) * f(AL[r],AL[c]) = sum_r w(c,r) * f(AL[r],AL[c]), as w is symmetric
+template<typename T>
+void MarkovChain<T>::columnSums() {
+	m_Colsum.assign(m_Size, 0);
+	m_Tmp.resize(m_Size);
+
+	for(int c = 0 ; c < m_Size ; ++c) {
+		T ac  = m_AL[c];
+		Summation<T> acc;
+
+		if(m_Graph == NULL) {
+			const T *w = m_Weights + static_cast<size_t>(c) * m_Stride;
+			for(int r = 0 ; r < m_Size ; ++r) {
+				acc.add(w[r] * edgeFactor(m_Algtype, m_AL[r], ac));
+			}
+		} else {
+			for(int k = m_Graph->rowPtr[c] ; k < m_Graph->rowPtr[c+1] ; ++k) {
+				acc.add(m_Weights[k] * edgeFactor(m_Algtype, m_AL[m_Graph->colIdx[k]], ac));
+			}
+		}
+
+		T sum = acc.value();
+
+		if(std::abs(sum) < 0.00000000001) {
+			sum = static_cast<T>(0.00000000001);
+		}
+
+		m_Colsum[c] = sum;
+	}
+}
+
+
+
+template<typename T>
+void MarkovChain<T>::apply(const T *v, T *out) const {
+	// fold the column normalization into the vector
+	for(int c = 0 ; c < m_Size ; ++c) {
+		m_Tmp[c] = v[c] / m_Colsum[c];
+	}
+
+	rowProducts(&m_Tmp[0], out);
+}
+
+
+
+template<typename T>
+void MarkovChain<T>::rowProducts(const T *u, T *out) const {
+	if(m_Graph == NULL)
+		rowProductsDense(u, out);
+	else
+		rowProductsSparse(u, out);
+}
+
+
+
+template<typename T>
+inline void MarkovChain<T>::products(const T *w, T ar, int c, int n, const T *u, T *x) const {
+	const T *AL = m_AL + c;
+	u += c;
+
+	if(m_Algtype == 1) {
+		for(int i = 0 ; i < n ; ++i)
+			x[i] = w[i] * u[i];
+
+	} else if(m_Algtype == 2) {
+		for(int i = 0 ; i < n ; ++i)
+			x[i] = w[i] * std::abs(ar - AL[i]) * u[i];
+
+	} else {
+		for(int i = 0 ; i < n ; ++i)
+			x[i] = w[i] * edgeFactor(m_Algtype, ar, AL[i]) * u[i];
+	}
+}
+
+
+
+// rows are processed by blocks of 4, and each row by blocks of LaneSummation::Lanes nodes: the products
+// of a block and their compensated sums are simple enough to be vectorized by the compiler.
+template<typename T>
+void MarkovChain<T>::rowProductsDense(const T *u, T *out) const {
+	const int N = m_Size;
+	const int L = LaneSummation<T>::Lanes;
+	const T *AL = m_AL;
+
+	T x[L];
+
+	for(int r = 0 ; r < N ; r += 4) {
+		const int rows = std::min(4, N - r);
+		LaneSummation<T> s[4];
+
+		int c = 0;
+		for( ; c + L <= N ; c += L) {
+			for(int b = 0 ; b < rows ; ++b) {
+				products(m_Weights + static_cast<size_t>(r+b) * m_Stride + c, AL[r+b], c, L, u, x);
+				s[b].add(x);
+			}
+		}
+
+		// last block, completed with zeros
+		if(c < N) {
+			std::fill(x, x + L, static_cast<T>(0));
+			for(int b = 0 ; b < rows ; ++b) {
+				products(m_Weights + static_cast<size_t>(r+b) * m_Stride + c, AL[r+b], c, N - c, u, x);
+				s[b].add(x);
+			}
+		}
+
+		for(int b = 0 ; b < rows ; ++b) {
+			out[r+b] = (m_Algtype == 1) ? s[b].value() * AL[r+b] : s[b].value();
+		}
+	}
+}
+
+
+
+// the neighbours of a row are gathered by blocks of LaneSummation::Lanes edges, summed like the dense rows
+template<typename T>
+void MarkovChain<T>::rowProductsSparse(const T *u, T *out) const {
+	const ArrayView<int> &rowPtr = m_Graph->rowPtr;
+	const ArrayView<int> &colIdx = m_Graph->colIdx;
+	const int L = LaneSummation<T>::Lanes;
+	const T *AL = m_AL;
+
+	T x[L];
+
+	for(int r = 0 ; r < m_Size ; ++r) {
+		T ar = AL[r];
+		LaneSummation<T> s;
+
+		int k = rowPtr[r];
+		const int end = rowPtr[r+1];
+
+		for( ; k < end ; k += L) {
+			const int n = std::min(L, end - k);
+			std::fill(x + n, x + L, static_cast<T>(0));
+
+			if(m_Algtype == 1) {
+				for(int i = 0 ; i < n ; ++i)
+					x[i] = m_Weights[k+i] * u[colIdx[k+i]];
+			} else {
+				for(int i = 0 ; i < n ; ++i) {
+					int c = colIdx[k+i];
+					x[i] = m_Weights[k+i] * edgeFactor(m_Algtype, ar, AL[c]) * u[c];
+				}
+			}
+
+			s.add(x);
+		}
+
+		out[r] = (m_Algtype == 1) ? s.value() * ar : s.value();
+	}
+}
+
+
+
+
+// initial vector of the iterations: uniform, or AL when it can be used as a distribution. The elements
+// of v are stride apart.
+template<typename T>
+void initialVector(const std::vector<T> &AL, int D, bool warmStart, T *v, int stride) {
+	double sum = 0;
+	bool positive = warmStart;
+	for(int i = 0 ; i < D && positive ; ++i) {
+		positive = AL[i] >= 0;
+		sum += AL[i];
+	}
+
+	for(int i = 0 ; i < D ; ++i) {
+		v[i*stride] = (positive && sum > 0) ? static_cast<T>(AL[i] / sum) : static_cast<T>(1.f/D);
+	}
+}
+
+
+
+template<typename T>
+void principalEigenvector(const MarkovChain<T> &markov, double tol, std::vector<T> &AL, int &iteri, bool warmStart) {
+	int D = markov.size();
+	double df = 1.0f;
+
+	std::vector<T> v(D);
+	initialVector(AL, D, warmStart, &v[0], 1);
+	std::vector<T> oldv = v;
+	std::vector<T> oldoldv = v;
+
+	iteri = 0;
+
+	while(df > tol && iteri < 10000 ) {
+
+		// oldoldv <- oldv <- v, and v is then overwritten by M * oldv
+		oldoldv.swap(oldv);
+		oldv.swap(v);
+
+		markov.apply(&oldv[0], &v[0]);
+
+		// same stopping rule as principalEigenvectorRaw, which only looks at the first node
+		double diff = oldv[0] - v[0];
+		df = std::sqrt(diff*diff);
+		double sum = v[0];
+
+		++iteri;
+
+		if( sum >= 0 )
+			continue;
+		else {
+			v = oldoldv;
+			break;
+		}
+	}
+
+	double sum = 0;
+	for(int i = 0 ; i < D ; ++i) {
+		sum += v[i];
+	}
+
+	for(int i = 0 ; i < D ; ++i) {
+		AL[i] = static_cast<T>(v[i] / sum);
+	}
+}
+
+
+
+template<typename T>
+void principalEigenvectorExtrapolated(const MarkovChain<T> &markov, double tol, std::vector<T> &AL, int &iteri, bool warmStart) {
+	int D = markov.size();
+	double df = 1.0f;
+
+	std::vector<T> v(D);
+	initialVector(AL, D, warmStart, &v[0], 1);
+
+	// the extrapolation uses the last three iterates, every aitkenPeriod iterations. Extrapolating at each
+	// step is often slower on the GBVS graphs, as the iterates are not yet dominated by one eigenvalue.
+	const int aitkenPeriod = 8;
+
+	std::vector<T> w(D);
+	std::vector<T> x0, x1;			// the two previous iterates
+	int history = 0;				// number of iterations since the last extrapolation
+
+	iteri = 0;
+
+	while(df > tol && iteri < 10000) {
+
+		markov.apply(&v[0], &w[0]);
+		++iteri;
+
+		Summation<T> acc;
+		for(int i = 0 ; i < D ; ++i) {
+			acc.add(w[i]);
+		}
+
+		// the chain lost its mass (same case as the rollback of principalEigenvector): keep the last iterate
+		double sum = acc.value();
+		if(!(sum > 0))
+			break;
+
+		df = 0;
+		for(int i = 0 ; i < D ; ++i) {
+			w[i] = static_cast<T>(w[i] / sum);
+			df = std::max(df, static_cast<double>(std::abs(w[i] - v[i])));
+		}
+
+		if(history >= aitkenPeriod && df > tol) {
+			// Aitken delta-squared on each node: y = x2 - (x2-x1)^2 / (x2 - 2*x1 + x0)
+			bool valid = true;
+			Summation<T> ysum;
+			for(int i = 0 ; i < D && valid ; ++i) {
+				double d1 = static_cast<double>(w[i]) - x1[i];
+				double d2 = d1 - (static_cast<double>(x1[i]) - x0[i]);
+				double y = (std::abs(d2) > 1e-30) ? w[i] - d1*d1/d2 : w[i];
+
+				valid = y >= 0 && y == y;
+				v[i] = static_cast<T>(y);
+				ysum.add(v[i]);
+			}
+
+			if(valid && ysum.value() > 0) {
+				for(int i = 0 ; i < D ; ++i) {
+					v[i] = static_cast<T>(v[i] / ysum.value());
+				}
+			} else {
+				v = w;
+			}
+
+			history = 0;
+			continue;
+		}
+
+		// keep the iterates for the next extrapolation
+		x0.swap(x1);
+		x1 = w;
+		++history;
+
+		v.swap(w);
+	}
+
+	double sum = 0;
+	for(int i = 0 ; i < D ; ++i) {
+		sum += v[i];
+	}
+
+	for(int i = 0 ; i < D ; ++i) {
+		AL[i] = static_cast<T>(v[i] / sum);
+	}
+}
+
+
+
+
+
+
+// ==============================================================================================================================
+// batched chains
+
+
+template<typename T>
+BatchedMarkovChain<T>::BatchedMarkovChain(const T *weights, int stride, const std::vector< std::vector<T>* > &AL, int algtype) :
+	m_Weights(weights), m_Graph(NULL), m_Size(static_cast<int>(AL[0]->size())), m_Stride(stride), m_Algtype(algtype) {
+
+	init(AL);
+}
+
+
+template<typename T>
+BatchedMarkovChain<T>::BatchedMarkovChain(const SparseGraph &graph, const T *weights, const std::vector< std::vector<T>* > &AL, int algtype) :
+	m_Weights(weights), m_Graph(&graph), m_Size(static_cast<int>(graph.rowPtr.size())-1), m_Stride(0), m_Algtype(algtype) {
+
+	init(AL);
+}
+
+
+
+template<typename T>
+void BatchedMarkovChain<T>::init(const std::vector< std::vector<T>* > &AL) {
+	m_Batch  = static_cast<int>(AL.size());
+	m_Active = m_Batch;
+
+	const int K = m_Batch;
+
+	m_AL.resize(static_cast<size_t>(m_Size) * K);
+	for(int c = 0 ; c < m_Size ; ++c) {
+		for(int k = 0 ; k < K ; ++k) {
+			m_AL[c*K + k] = (*AL[k])[c];
+		}
+	}
+
+	m_Tmp.resize(m_AL.size());
+	m_Sum.resize(K);
+	m_Comp.resize(K);
+
+	// column sums, computed along the rows as the weights are symmetric (see MarkovChain::columnSums)
+	m_Colsum.assign(m_AL.size(), 0);
+	std::vector< Summation<T> > sum(K);
+	for(int c = 0 ; c < m_Size ; ++c) {
+		const T *ac = &m_AL[c*K];
+		std::fill(sum.begin(), sum.end(), Summation<T>());
+
+		if(m_Graph == NULL) {
+			const T *w = m_Weights + static_cast<size_t>(c) * m_Stride;
+			for(int r = 0 ; r < m_Size ; ++r) {
+				const T *ar = &m_AL[r*K];
+				for(int k = 0 ; k < K ; ++k) {
+					sum[k].add(w[r] * MarkovChain<T>::edgeFactor(m_Algtype, ar[k], ac[k]));
+				}
+			}
+		} else {
+			for(int n = m_Graph->rowPtr[c] ; n < m_Graph->rowPtr[c+1] ; ++n) {
+				const T *ar = &m_AL[m_Graph->colIdx[n]*K];
+				for(int k = 0 ; k < K ; ++k) {
+					sum[k].add(m_Weights[n] * MarkovChain<T>::edgeFactor(m_Algtype, ar[k], ac[k]));
+				}
+			}
+		}
+
+		for(int k = 0 ; k < K ; ++k) {
+			T colsum = sum[k].value();
+			if(std::abs(colsum) < 0.00000000001) {
+				colsum = static_cast<T>(0.00000000001);
+			}
+			m_Colsum[c*K + k] = colsum;
+		}
+	}
+}
+
+
+
+template<typename T>
+void BatchedMarkovChain<T>::retire(int k) {
+	const int K = m_Batch;
+	const int last = m_Active - 1;
+
+	if(k != last) {
+		for(int c = 0 ; c < m_Size ; ++c) {
+			std::swap(m_AL[c*K + k], m_AL[c*K + last]);
+			std::swap(m_Colsum[c*K + k], m_Colsum[c*K + last]);
+		}
+	}
+
+	--m_Active;
+}
+
+
+
+template<typename T>
+void BatchedMarkovChain<T>::apply(const T *v, T *out) const {
+	const int K = m_Batch;
+
+	for(int c = 0 ; c < m_Size ; ++c) {
+		for(int k = 0 ; k < m_Active ; ++k) {
+			m_Tmp[c*K + k] = v[c*K + k] / m_Colsum[c*K + k];
+		}
+	}
+
+	rowProducts(&m_Tmp[0], out);
+}
+
+
+
+// sum[k] += w * f(ar[k], ac[k]) * uc[k] for all the active chains. The chains are the lanes of the
+// compensated sums (see LaneSummation), so that the loops over the chains are vectorized.
+template<typename T>
+inline void BatchedMarkovChain<T>::accumulate(T w, const T *ar, const T *ac, const T *uc, T *sum, T *comp) const {
+	const int Ka = m_Active;
+
+	if(m_Algtype == 1) {
+		// AL[r] is applied once the row is done
+		for(int k = 0 ; k < Ka ; ++k) {
+			Summation<T>::step(sum[k], comp[k], w * uc[k]);
+		}
+	} else if(m_Algtype == 2) {
+		for(int k = 0 ; k < Ka ; ++k) {
+			Summation<T>::step(sum[k], comp[k], w * std::abs(ar[k] - ac[k]) * uc[k]);
+		}
+	} else {
+		for(int k = 0 ; k < Ka ; ++k) {
+			Summation<T>::step(sum[k], comp[k], w * MarkovChain<T>::edgeFactor(m_Algtype, ar[k], ac[k]) * uc[k]);
+		}
+	}
+}
+
+
+
+template<typename T>
+void BatchedMarkovChain<T>::rowProducts(const T *u, T *out) const {
+	const int K  = m_Batch;
+	const int Ka = m_Active;
+	T *sum  = &m_Sum[0];
+	T *comp = &m_Comp[0];
+
+	for(int r = 0 ; r < m_Size ; ++r) {
+		const T *ar = &m_AL[r*K];
+		std::fill(sum, sum + Ka, static_cast<T>(0));
+		std::fill(comp, comp + Ka, static_cast<T>(0));
+
+		if(m_Graph == NULL) {
+			const T *w = m_Weights + static_cast<size_t>(r) * m_Stride;
+			for(int c = 0 ; c < m_Size ; ++c) {
+				accumulate(w[c], ar, &m_AL[c*K], &u[c*K], sum, comp);
+			}
+		} else {
+			for(int n = m_Graph->rowPtr[r] ; n < m_Graph->rowPtr[r+1] ; ++n) {
+				int c = m_Graph->colIdx[n];
+				accumulate(m_Weights[n], ar, &m_AL[c*K], &u[c*K], sum, comp);
+			}
+		}
+
+		// the compensation holds the opposite of the low order bits lost by the sum
+		if(m_Algtype == 1) {
+			for(int k = 0 ; k < Ka ; ++k) {
+				out[r*K + k] = (sum[k] - comp[k]) * ar[k];
+			}
+		} else {
+			for(int k = 0 ; k < Ka ; ++k) {
+				out[r*K + k] = sum[k] - comp[k];
+			}
+		}
+	}
+}
+
+
+
+
+template<typename T>
+void principalEigenvectors(BatchedMarkovChain<T> &markov, double tol, std::vector< std::vector<T>* > &AL, std::vector<int> &iteri, bool warmStart) {
+	const int D = markov.size();
+	const int K = markov.batch();
+
+	std::vector<T> v(static_cast<size_t>(D) * K);
+	for(int k = 0 ; k < K ; ++k) {
+		initialVector(*AL[k], D, warmStart, &v[k], K);
+	}
+	std::vector<T> oldv = v;
+	std::vector<T> oldoldv = v;
+
+	// slot[k]: chain stored in the column k of the vectors
+	std::vector<int> slot(K);
+	for(int k = 0 ; k < K ; ++k)
+		slot[k] = k;
+
+	iteri.assign(K, 0);
+
+	while(markov.active() > 0) {
+
+		oldoldv.swap(oldv);
+		oldv.swap(v);
+
+		markov.apply(&oldv[0], &v[0]);
+
+		// going backward, the chain moved into a retired column has already been checked
+		for(int k = markov.active()-1 ; k >= 0 ; --k) {
+			int m = slot[k];
+			++iteri[m];
+
+			// same stopping rule as principalEigenvectorRaw, which only looks at the first node
+			double diff = oldv[k] - v[k];
+			double df   = std::sqrt(diff*diff);
+			double sum  = v[k];
+
+			bool rollback = sum < 0;
+			if(!rollback && df > tol && iteri[m] < 10000)
+				continue;
+
+			const std::vector<T> &result = rollback ? oldoldv : v;
+			double total = 0;
+			for(int i = 0 ; i < D ; ++i) {
+				total += result[i*K + k];
+			}
+			for(int i = 0 ; i < D ; ++i) {
+				(*AL[m])[i] = static_cast<T>(result[i*K + k] / total);
+			}
+
+			// remove the chain from the batch
+			int last = markov.active()-1;
+			if(k != last) {
+				for(int i = 0 ; i < D ; ++i) {
+					std::swap(v[i*K + k], v[i*K + last]);
+					std::swap(oldv[i*K + k], oldv[i*K + last]);
+					std::swap(oldoldv[i*K + k], oldoldv[i*K + last]);
+				}
+				std::swap(slot[k], slot[last]);
+			}
+			markov.retire(k);
+		}
+	}
+}
@@ -0,0 +1,265 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+
+
+
+ThreadPool::ThreadPool(int nbThreads) : m_Stop(false), m_Available(0) {
+	resize(nbThreads);
+}
+
+
+ThreadPool::~ThreadPool() {
+	stop();
+}
+
+
+
+ThreadPool& ThreadPool::global() {
+	static ThreadPool pool(std::max(0, static_cast<int>(boost::thread::hardware_concurrency()) - 1));
+	return pool;
+}
+
+
+
+int ThreadPool::size() const {
+	return static_cast<int>(m_Threads.size());
+}
+
+
+
+void ThreadPool::stop() {
+	{
+		boost::mutex::scoped_lock lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Wakeup.notify_all();
+
+	for(size_t i = 0 ; i < m_Threads.size() ; ++i) {
+		m_Threads[i]->join();
+	}
+	m_Threads.clear();
+}
+
+
+
+void ThreadPool::resize(int nbThreads) {
+	nbThreads = std::max(0, nbThreads);
+	if(nbThreads == size())
+		return;
+
+	// the threads are restarted: the pool must be idle
+	stop();
+
+	m_Stop = false;
+	m_Available = nbThreads;
+	for(int i = 0 ; i < nbThreads ; ++i) {
+		m_Threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&ThreadPool::worker, this))));
+	}
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// loops
+
+
+void ThreadPool::parallelFor(int n, const Job &job, int width) {
+	if(n <= 0) return;
+
+	if(width <= 0)
+		width = size() + 1;
+	width = std::min(width, n);
+
+	// nothing to share: run the loop in the calling thread
+	if(width == 1 || m_Threads.empty()) {
+		for(int i = 0 ; i < n ; ++i) {
+			job(i, 0);
+		}
+		return;
+	}
+
+	boost::shared_ptr<Loop> loop(new Loop());
+	loop->job = job;
+	loop->width = width;
+	loop->slices.reset(new Slice[width]);
+	for(int s = 0 ; s < width ; ++s) {
+		loop->slices[s].next = static_cast<int>((static_cast<long long>(n) * s) / width);
+		loop->slices[s].end  = static_cast<int>((static_cast<long long>(n) * (s+1)) / width);
+	}
+	loop->participants = 1;			// the caller has the slot 0
+	loop->remaining = n;
+
+	{
+		boost::mutex::scoped_lock lock(m_Mutex);
+		m_Loops.push_back(loop);
+	}
+
+	if(width - 1 >= size())
+		m_Wakeup.notify_all();
+	else
+		for(int i = 0 ; i < width - 1 ; ++i)
+			m_Wakeup.notify_one();
+
+	participate(*loop, 0);
+
+	// wait for the tasks taken by the other participants
+	{
+		boost::mutex::scoped_lock lock(loop->mutex);
+		while(loop->remaining.load() > 0) {
+			loop->finished.wait(lock);
+		}
+	}
+
+	// the loop may still be queued if some slots were never taken
+	{
+		boost::mutex::scoped_lock lock(m_Mutex);
+		std::deque< boost::shared_ptr<Loop> >::iterator it = std::find(m_Loops.begin(), m_Loops.end(), loop);
+		if(it != m_Loops.end())
+			m_Loops.erase(it);
+	}
+
+	if(loop->error)
+		boost::rethrow_exception(loop->error);
+}
+
+
+
+void ThreadPool::runTask(const std::vector<Task> *tasks, int task) {
+	(*tasks)[task]();
+}
+
+
+void ThreadPool::invoke(const std::vector<Task> &tasks, int width) {
+	parallelFor(static_cast<int>(tasks.size()), boost::bind(&ThreadPool::runTask, &tasks, _1), width);
+}
+
+
+
+// claim the tasks of its own slice, then steal the tasks of the other slices
+void ThreadPool::participate(Loop &loop, int slot) {
+	int done = 0;
+
+	for(int k = 0 ; k < loop.width ; ++k) {
+		Slice &slice = loop.slices[(slot + k) % loop.width];
+
+		while(true) {
+			int task = slice.next.fetch_add(1);
+			if(task >= slice.end)
+				break;
+
+			try {
+				loop.job(task, slot);
+			} catch(...) {
+				boost::mutex::scoped_lock lock(loop.mutex);
+				if(!loop.error)
+					loop.error = boost::current_exception();
+			}
+			++done;
+		}
+	}
+
+	if(done > 0 && loop.remaining.fetch_sub(done) == done) {
+		boost::mutex::scoped_lock lock(loop.mutex);
+		loop.finished.notify_all();
+	}
+}
+
+
+
+void ThreadPool::worker() {
+	while(true) {
+		boost::shared_ptr<Loop> loop;
+		int slot = 0;
+
+		{
+			boost::mutex::scoped_lock lock(m_Mutex);
+			while(!m_Stop && (m_Loops.empty() || m_Available == 0)) {
+				m_Wakeup.wait(lock);
+			}
+
+			if(m_Stop)
+				return;
+
+			loop = m_Loops.front();
+			slot = loop->participants.fetch_add(1);
+			--m_Available;
+
+			// all the slots are taken: the loop is not offered anymore
+			if(slot >= loop->width - 1)
+				m_Loops.pop_front();
+		}
+
+		if(slot < loop->width)
+			participate(*loop, slot);
+
+		{
+			boost::mutex::scoped_lock lock(m_Mutex);
+			++m_Available;
+		}
+	}
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// thread budget
+
+
+int ThreadPool::acquire(int wanted) {
+	if(wanted <= 1)
+		return 1;
+
+	boost::mutex::scoped_lock lock(m_Mutex);
+	int extra = std::min(wanted - 1, m_Available);
+	m_Available -= extra;
+	return extra + 1;
+}
+
+
+void ThreadPool::release(int granted) {
+	if(granted <= 1)
+		return;
+
+	{
+		boost::mutex::scoped_lock lock(m_Mutex);
+		m_Available += granted - 1;
+	}
+
+	// the tokens may let some workers join the pending loops
+	m_Wakeup.notify_all();
+}
+
+
+
+ThreadPool::Share::Share(int wanted, ThreadPool &pool) : m_Pool(pool) {
+	m_Granted = m_Pool.acquire(wanted);
+}
+
+
+ThreadPool::Share::~Share() {
+	m_Pool.release(m_Granted);
+}
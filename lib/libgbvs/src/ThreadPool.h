@@ -0,0 +1,134 @@
+// **************************************************************************************************
+//
+// This program was implemented by Pierre Lebreton
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// **************************************************************************************************
+
+
+#ifndef _THREADPOOL_
+#define _THREADPOOL_
+
+#include <deque>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+// Persistent pool of threads shared by all the stages of the pipeline. The work is submitted as 
+// parallel loops: the tasks [0, n) are split in one slice per participant, the participants claim the
+// tasks of their slice with an atomic counter and then steal from the other slices. The calling 
+// thread always takes part in its loop, so a task can start a nested loop without blocking the pool.
+//
+// The threads are created once, and wait on a condition variable between two loops.
+//
+// The pool also owns the thread budget of the process: the callers hold one thread, and size() tokens
+// are shared by the workers of the pool and the nested parallel regions run outside of it (OpenMP loops 
+// of libgnomonic). A worker needs a token to join a loop, and a region gets the tokens which are free
+// when it starts, so the number of running threads never exceeds size() + 1.
+
+class ThreadPool {
+
+public:
+
+	// job(task, slot): slot is the index of the participant running the task, in [0, width). It can be 
+	// used to give each participant its own workspace.
+	typedef boost::function<void (int, int)> 	Job;
+	typedef boost::function<void ()> 			Task;
+
+						 ThreadPool 	(int nbThreads = 0);
+						~ThreadPool 	();
+
+	// pool of the pipeline. By default, it has one thread less than the number of cores: the caller 
+	// is the last participant.
+	static ThreadPool& 	global 			();
+
+	// number of threads of the pool (without the callers). Must not be called during a loop.
+	void 				resize 			(int nbThreads);
+	int 				size 			() const;
+
+	// run job(i, slot) for i in [0, n), with at most width participants, the caller included (width <= 0:
+	// all the threads of the pool). Returns when all the tasks are done. The first exception thrown by a 
+	// task is forwarded to the caller once the loop is over.
+	void 				parallelFor 	(int n, const Job &job, int width = 0);
+
+	// run heterogeneous tasks in parallel, same as parallelFor
+	void 				invoke 			(const std::vector<Task> &tasks, int width = 0);
+
+	// reserve up to wanted threads for a parallel region run by the caller, the caller included. Never
+	// blocks: returns at least 1. The threads must be given back with release().
+	int 				acquire 		(int wanted);
+	void 				release 		(int granted);
+
+
+	// threads reserved for a region while the object is alive
+	class Share {
+	public:
+						 Share 			(int wanted, ThreadPool &pool = ThreadPool::global());
+						~Share 			();
+
+		int 			size 			() const 	{ return m_Granted; }
+
+	private:
+						 Share 			(const Share &);
+		Share& 			operator= 		(const Share &);
+
+		ThreadPool 		&m_Pool;
+		int 			m_Granted;
+	};
+
+
+private:
+
+	struct Slice {
+		boost::atomic<int> 				next;
+		int 							end;
+	};
+
+	struct Loop {
+		Job 							job;
+		int 							width;
+		boost::scoped_array<Slice> 		slices;
+		boost::atomic<int> 				participants;
+		boost::atomic<int> 				remaining;
+
+		boost::mutex 					mutex;
+		boost::condition_variable 		finished;
+		boost::exception_ptr 			error;
+	};
+
+	void 				worker 			();
+	void 				stop 			();
+	static void 		participate 	(Loop &loop, int slot);
+	static void 		runTask 		(const std::vector<Task> *tasks, int task);
+
+
+	std::vector< boost::shared_ptr<boost::thread> > m_Threads;
+	bool 										m_Stop;
+	int 										m_Available;	// free tokens of the budget
+
+	boost::mutex 								m_Mutex;
+	boost::condition_variable 					m_Wakeup;
+	std::deque< boost::shared_ptr<Loop> > 		m_Loops;		// loops which still have free slots
+};
+
+
+#endif
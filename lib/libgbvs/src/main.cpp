@@ -33,6 +33,8 @@
 #include <boost/bind.hpp>
 
 #include "GBVS.h"
+#include "FrameCache.h"
+#include "FFTPlans.h"
 
 
 
@@ -131,6 +133,16 @@ int main(int argc, char **argv) {
 		("equatorial-prior", "Apply an equatorial-prior to the images. This was designed for equirectangular images. It may not be a good idea for rectilinear images.")
 		("apply-fms", po::value< int >(), "Compute the FMS model: apply the saliency algorithm on several shifted images. The provided parameter is the number of projection (4 recommended)")
 		("disable-csf", "Disable the contrast sensitivity function. This was not part of the orginal GBVS model, and may cause a crash if you don't have enough memory to allocate enough _ALIGNED_ memory required by the Fourier transform.")
+		("orientation-filter", po::value< int >(), "Filtering of the orientation channel: 0) fastest method for each level, 1) spatial, 2) separable, 3) Fourier transform. Default: 0")
+		("sparse-graph", po::value< double >(), "Use a sparse graph for the activation: edges with a weight below the provided cutoff are dropped (e.g. 0.001). Default: dense graph")
+		("graph-engine", po::value< int >(), "Activation engine: 1) the markov matrix is built, 2) matrix-free markov chain. Default: 1")
+		("activation-batch", po::value< int >(), "Number of feature maps solved together by an activation job (matrix-free engine only). Default: 1")
+		("single-precision", "The markov chains of the activation are computed in single precision (matrix-free engine only).")
+		("eigen-solver", po::value< int >(), "Eigenvector solver of the activation: 1) power iterations, 2) power iterations with Aitken extrapolation (matrix-free engine only). Default: 1")
+		("warm-start", "The eigenvector iterations start from the map instead of the uniform vector (matrix-free engine only).")
+		("report-iterations", "Print the number of iterations of the activation and normalization of each map.")
+		("graph-cache", po::value< std::string >(), "Directory where the graphs of the activation are stored. They are loaded from it instead of being built at each run, and added to it when missing.")
+		("fft-wisdom", po::value< std::string >(), "File where the FFTW plans of the contrast sensitivity function are saved and loaded from. Empty to disable it. Default: wisdom3.txt")
 		("channels-description", "Show a description of the different channels options")
 	;
 
@@ -213,6 +225,49 @@ int main(int argc, char **argv) {
 		gbvs.equatorialPrior = true;
 	}
 
+	if(vm.count("orientation-filter")) {
+		gbvs.orientationFilter = vm["orientation-filter"].as< int >();
+	}
+
+	if(vm.count("sparse-graph")) {
+		gbvs.sparseGraph = true;
+		gbvs.sparseCutoff = vm["sparse-graph"].as< double >();
+	}
+
+	if(vm.count("graph-engine")) {
+		gbvs.graphEngine = vm["graph-engine"].as< int >();
+	}
+
+	if(vm.count("activation-batch")) {
+		gbvs.activationBatch = vm["activation-batch"].as< int >();
+	}
+
+	if(vm.count("single-precision")) {
+		gbvs.singlePrecision = true;
+	}
+
+	if(vm.count("eigen-solver")) {
+		gbvs.eigenSolver = vm["eigen-solver"].as< int >();
+	}
+
+	if(vm.count("warm-start")) {
+		gbvs.warmStart = true;
+	}
+
+	if(vm.count("report-iterations")) {
+		gbvs.reportIterations = true;
+	}
+
+	if(vm.count("graph-cache")) {
+		FrameCache::setDirectory(vm["graph-cache"].as< std::string >());
+	}
+
+#ifdef WITH_FFTW
+	if(vm.count("fft-wisdom")) {
+		FFTPlans::setWisdomFile(vm["fft-wisdom"].as< std::string >());
+	}
+#endif
+
 	int nb_projections = 1;
 	if(vm.count("apply-fms")) {
 		nb_projections = vm["apply-fms"].as< int >();
@@ -28,6 +28,7 @@
 
 #include <BMS.h>
 #include <BMS360.h>
+#include <ThreadPool.h>
 #include <opencv2/opencv.hpp>
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
@@ -87,12 +88,7 @@ void BMSSaliency::process(const cv::Mat &inputImage, cv::Mat &sMap, bool normali
 
 
     std::vector<cv::Mat> outputs(nb_projections);
-    boost::thread_group g;
-    for(int i = 0 ; i < nb_projections ; ++i) {
-    	g.create_thread(boost::bind(&BMSSaliency::processJob, this, i, nb_projections, boost::ref(inputImage), boost::ref(outputs), boost::ref(conf)));
-
-    }
-    g.join_all();
+    ThreadPool::global().parallelFor(nb_projections, boost::bind(&BMSSaliency::processJob, this, _1, nb_projections, boost::cref(inputImage), boost::ref(outputs), boost::ref(conf)), nb_projections);
 
 
 
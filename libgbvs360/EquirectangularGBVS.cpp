@@ -0,0 +1,212 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#include "EquirectangularGBVS.h"
+
+#include <cmath>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <LowPass.h>
+
+
+// variance of the kernel [1 5 10 10 5 1] / 32 of lowPass6Dec
+static const double lowPassVariance = 1.25;
+
+
+
+double EquirectangularGBVS::stretch(int row, int rows, double maxStretch) {
+	double latitude = ((row + 0.5) / rows - 0.5) * M_PI;
+	double c = std::cos(latitude);
+
+	if(c * maxStretch <= 1)
+		return maxStretch;
+	return std::max(1.0, 1.0 / c);
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// pyramid
+
+
+// row of n samples convolved with a gaussian, the row being periodic
+static void blurRowCyclic(const double *src, double *dst, int n, double sigma, std::vector<double> &kernel, std::vector<double> &buffer) {
+	int radius = static_cast<int>(std::ceil(3 * sigma));
+
+	kernel.resize(2*radius+1);
+	double sum = 0;
+	for(int k = -radius ; k <= radius ; ++k) {
+		kernel[k+radius] = std::exp(-k*k / (2*sigma*sigma));
+		sum += kernel[k+radius];
+	}
+
+	buffer.resize(n + 2*radius);
+	for(int x = 0 ; x < n + 2*radius ; ++x) {
+		buffer[x] = src[((x - radius) % n + n) % n];
+	}
+
+	for(int x = 0 ; x < n ; ++x) {
+		double v = 0;
+		for(int k = 0 ; k <= 2*radius ; ++k) {
+			v += kernel[k] * buffer[x+k];
+		}
+		dst[x] = v / sum;
+	}
+}
+
+
+cv::Mat EquirectangularGBVS::subsample(const cv::Mat& img) const {
+	if(img.cols <= 10 || img.rows <= 10)
+		return GBVS::subsample(img);
+
+	// the gaussian adds the variance missing to the kernel of lowPass6Dec: s^2 * v = v + (s^2 - 1) * v. 
+	// Its radius is kept within half a row.
+	const double maxStretch = std::sqrt(1 + img.cols * img.cols / (36 * lowPassVariance));
+
+	cv::Mat widened(img.rows, img.cols, CV_64FC1);
+	std::vector<double> kernel, buffer;
+	for(int i = 0 ; i < img.rows ; ++i) {
+		double s = stretch(i, img.rows, maxStretch);
+		double sigma = std::sqrt(lowPassVariance * (s*s - 1));
+
+		if(sigma < 0.25) {
+			std::copy(img.ptr<double>(i), img.ptr<double>(i) + img.cols, widened.ptr<double>(i));
+		} else {
+			blurRowCyclic(img.ptr<double>(i), widened.ptr<double>(i), img.cols, sigma, kernel, buffer);
+		}
+	}
+
+	// with 2 columns wrapped on the left and 4 on the right, the outputs 1 ... cols/2 of lowPass6Dec are 
+	// the decimated row with the full kernel everywhere, the first sample being centred as in lowPass6Dec
+	cv::Mat padded, decimated;
+	cv::copyMakeBorder(widened, padded, 0, 0, 2, 4, cv::BORDER_WRAP);
+	lowPass6Dec(padded, decimated);
+
+	return decimated.colRange(1, 1 + img.cols / 2).clone();
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// orientation
+
+
+// rows of a response of (width + 2 * offset) samples, the image of width samples being centred, stretched to 
+// the rows of out by linear interpolation. The margins hold the wrapped samples.
+static void stretchRows(const cv::Mat &response, int offset, int width, cv::Mat &out) {
+	const double scale = static_cast<double>(width) / out.cols;
+
+	for(int i = 0 ; i < out.rows ; ++i) {
+		const double *src = response.ptr<double>(i);
+		double *dst = out.ptr<double>(i);
+
+		for(int x = 0 ; x < out.cols ; ++x) {
+			double p = (x + 0.5) * scale - 0.5 + offset;
+			int p0 = static_cast<int>(std::floor(p));
+			double f = p - p0;
+
+			dst[x] = (1-f) * src[p0] + f * src[p0+1];
+		}
+	}
+}
+
+
+void EquirectangularGBVS::filterBand(const cv::Mat& img, int first, int last, double bandStretch, int marginX, int marginY, std::vector<cv::Mat> &energies) const {
+
+	// the rows of the band, with the rows needed by the kernels. Beyond the poles, the border of 
+	// GaborBank is used.
+	int top 	= std::max(0, first - marginY);
+	int bottom 	= std::min(img.rows, last + marginY);
+	cv::Mat rows = img.rowRange(top, bottom);
+
+	int width = std::max(1, static_cast<int>(std::round(img.cols / bandStretch)));
+	cv::Mat shrunk;
+	if(width == img.cols)
+		shrunk = rows;
+	else
+		cv::resize(rows, shrunk, cv::Size(width, rows.rows), 0, 0, cv::INTER_AREA);
+
+	// one more column than the kernels on each side, for the interpolation of stretchRows
+	int offset = marginX + 1;
+	cv::Mat padded;
+	cv::copyMakeBorder(shrunk, padded, 0, 0, offset, offset, cv::BORDER_WRAP);
+
+	std::vector<cv::Mat> responses;
+	gaborBank.apply(padded, responses, orientationFilter);
+
+	for(size_t o = 0 ; o < responses.size() ; ++o) {
+		cv::Mat response = responses[o].rowRange(first - top, last - top);
+		cv::Mat out = energies[o].rowRange(first, last);
+
+		if(width == img.cols)
+			response.colRange(offset, offset + img.cols).copyTo(out);
+		else
+			stretchRows(response, offset, width, out);
+	}
+}
+
+
+void EquirectangularGBVS::orientationEnergies(const cv::Mat& img, std::vector<cv::Mat> &energies) const {
+	energies.resize(gaborFilters.size());
+	if(gaborFilters.empty())
+		return;
+
+	for(size_t o = 0 ; o < energies.size() ; ++o) {
+		energies[o] = cv::Mat(img.rows, img.cols, CV_64FC1);
+	}
+
+	// extent of the kernels around their centre
+	int marginX = 0;
+	int marginY = 0;
+	for(size_t o = 0 ; o < gaborFilters.size() ; ++o) {
+		marginX = std::max(marginX, std::max(gaborFilters[o].g0.cols, gaborFilters[o].g90.cols) / 2);
+		marginY = std::max(marginY, std::max(gaborFilters[o].g0.rows, gaborFilters[o].g90.rows) / 2);
+	}
+
+	// the shrunk bands keep at least 4 kernels across
+	const double maxStretch = std::max(1.0, img.cols / (4.0 * (2*marginX + 1)));
+
+	// bands of rows with the same widening, in steps of 2^(1/4). The band uses the geometric mean of 
+	// the widening of its rows.
+	int first = 0;
+	while(first < img.rows) {
+		int band = static_cast<int>(4 * std::log2(stretch(first, img.rows, maxStretch)));
+
+		int last = first + 1;
+		while(last < img.rows && static_cast<int>(4 * std::log2(stretch(last, img.rows, maxStretch))) == band) {
+			++last;
+		}
+
+		filterBand(img, first, last, std::sqrt(stretch(first, img.rows, maxStretch) * stretch(last-1, img.rows, maxStretch)), marginX, marginY, energies);
+		first = last;
+	}
+}
+
+
+
+// there is no border along the longitudes, and the poles are handled by the widening
+void EquirectangularGBVS::attenuateBordersGBVS(cv::Mat &, int ) const {
+}
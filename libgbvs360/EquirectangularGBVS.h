@@ -0,0 +1,66 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _EquirectangularGBVS_
+#define _EquirectangularGBVS_
+
+#include <GBVS.h>
+
+
+// Feature extraction on the whole equirectangular image (see Option::featureFrontEnd), instead of the 
+// rectilinear frames. The pyramid and the orientation filters follow the sampling of the sphere: their 
+// horizontal extent is widened by 1/cos(latitude), and they wrap around at the +-180 degrees seam.
+//
+//  - subsample(): each row is blurred by a cyclic gaussian which brings the [1 5 10 10 5 1] kernel of 
+//    lowPass6Dec to the widened extent, and the level is then decimated with the seam wrapped.
+//  - orientationEnergies(): the level is cut in latitude bands in which the widening changes by less than
+//    2^(1/4). Each band is shrunk horizontally by its widening, filtered by the Gabor bank with the seam 
+//    wrapped, and stretched back.
+//
+// The other channels are computed from the pyramid as in GBVS.
+
+class EquirectangularGBVS : public GBVS {
+
+public:
+
+	// widening of the kernels on a row of the image: 1/cos(latitude), bounded by maxStretch
+	static double 		stretch 				(int row, int rows, double maxStretch);
+
+
+protected:
+
+	virtual cv::Mat 	subsample 				(const cv::Mat& img) 										const;
+	virtual void 		orientationEnergies 	(const cv::Mat& img, std::vector<cv::Mat> &energies) 		const;
+	virtual void 		attenuateBordersGBVS 	(cv::Mat &map, int borderSize) 								const;
+
+
+private:
+
+	void 				filterBand 				(const cv::Mat& img, int first, int last, double bandStretch, int marginX, int marginY, std::vector<cv::Mat> &energies) const;
+};
+
+
+#endif
@@ -40,8 +40,14 @@
 
 #include <HMDSim.h>
 #include <VPD.h>
+#include <ThreadPool.h>
+#include <FrameCache.h>
 
 #include "Projection.h"
+#include "RemapTable.h"
+#include "SphereGraph.h"
+#include "EquirectangularGBVS.h"
+#include "TilePlanner.h"
 #include "Options.h"
 #include "CSVReader.h"
 
@@ -54,18 +60,47 @@ GBVS360::GBVS360(boost::shared_ptr<Projection> projection) {
 	salmapmaxsize 	= 60;
 	featureScaling	= 1.0f;
 	hmdMode = false;
+
+	sparseGraph = Option::sparseGraphCutoff > 0;
+	sparseCutoff = Option::sparseGraphCutoff;
+	graphEngine = Option::graphEngine;
+	activationBatch = Option::activationBatch;
+	singlePrecision = Option::singlePrecision;
+	eigenSolver = Option::eigenSolver;
+	warmStart = Option::warmStart;
+	reportIterations = Option::reportIterations;
 }
 
 
-void GBVS360::compute(const cv::Mat& input, cv::Mat &output, bool normalize) {
+void GBVS360::getFeatures(const cv::Mat& input) {
+	if(Option::featureFrontEnd == 2) {
+		std::cout << "[I] Getting equirectangular features" << std::endl;
+		getEquirectangularNativeFeatures(input);
+		return;
+	}
+
+	std::cout << "[I] Getting rectilinear frames" << std::endl;
+	getRectilinearFrames(input);
+
+	// project each equililnear frame and get its feature maps, streamed on the pool
+	std::cout << "[I] Getting features per frame" << std::endl;
+	getRectilinearFeatures(input);
+
+	// back project feature maps to equirectangular coordinate
+	std::cout << "[I] Getting back-projected features" << std::endl;
+	getEquirectangularFeatures();
+}
+
+
+void GBVS360::computeFeatures(const cv::Mat& input) {
 
 	assert(input.channels() == 3 && input.type() == CV_8UC3);
 
-	nbThreads = std::max<int>(2, static_cast<int>(Option::threads / 3.f));
+	// the width is bounded by the thread budget of the pool, which is shared with the other stages
+	nbThreads = static_cast<int>(Option::threads);
 
 	// reset the framework.... 
 	m_ProjectedFrames.clear();
-	featureDone.clear();
 	m_GBVSWorkers.clear();
 	clear(); 					// reset GBVS features and keep init done. 
 
@@ -75,25 +110,18 @@ void GBVS360::compute(const cv::Mat& input, cv::Mat &output, bool normalize) {
 	m_EquirectangularFrameSize = input.size();
 	
 
+	// the graph is initialized on the pool while the features are computed
 	std::cout << "[I] Init graph framework -- scheduled" << std::endl;
-	boost::thread_group group;
-	group.create_thread(boost::bind(&GBVS360::initGBVS, this, boost::ref(input)));
-
-	std::cout << "[I] Getting rectilinear frames" << std::endl;
-	getRectilinearFrames(input);
-
-	// get feature maps for each equililnear frame
-	std::cout << "[I] Getting features per frame" << std::endl;
-	getRectilinearFeatures();
-
-	// back project feature maps to equirectangular coordinate
-	std::cout << "[I] Getting back-projected features" << std::endl;
-	getEquirectangularFeatures();
+	std::vector<ThreadPool::Task> stages;
+	stages.push_back(boost::bind(&GBVS360::getFeatures, this, boost::cref(input)));
+	stages.push_back(boost::bind(&GBVS360::initGBVS, this, boost::cref(input)));
+	ThreadPool::global().invoke(stages);
+}
 
 
-	std::cout << "[I] Waiting graph initialization to finish" << std::endl;
-	group.join_all();
+void GBVS360::compute(const cv::Mat& input, cv::Mat &output, bool normalize) {
 
+	computeFeatures(input);
 	
 	std::cout << "[I] Applying GBVS Activation, Normalization & Pooling" << std::endl;
 
@@ -120,11 +148,18 @@ void GBVS360::compute(const cv::Mat& input, cv::Mat &output, bool normalize) {
 				continue;
 			}
 
-			for (int i = 0; i < it->map.rows; ++i) {
-				for (int j = 0; j < it->map.cols-1; ++j) {
-					fprintf(f, "%20.20lf, ", it->map.at<double>(i, j));
+			// the maps on the sphere grid are exported as equirectangular images, like the other maps
+			cv::Mat map = it->map;
+			if(Option::sphereGraph > 0) {
+				map = cv::Mat(salmapmaxsize_v[0], salmapmaxsize_v[1], CV_64FC1);
+				SphereGraph::get(Option::sphereGraph)->render(it->map, map);
+			}
+
+			for (int i = 0; i < map.rows; ++i) {
+				for (int j = 0; j < map.cols-1; ++j) {
+					fprintf(f, "%20.20lf, ", map.at<double>(i, j));
 				}
-				fprintf(f, "%20.20lf\n", it->map.at<double>(i, it->map.cols - 1));
+				fprintf(f, "%20.20lf\n", map.at<double>(i, map.cols - 1));
 			}
 
 			fclose(f);
@@ -179,6 +214,11 @@ typedef std::set<FixationOption, FixationOptionComparison2> TFixationsSet;
 
 void GBVS360::scanPath(const cv::Mat& imgBGR, cv::Mat &out, bool inputSaliencyMap) {
 
+	// the transition matrices of the scanpaths are built on the nodes of the equirectangular grid
+	if(Option::sphereGraph > 0) {
+		throw std::logic_error(std::string("GBVS360::scanPath(): the scanpaths are not available with the sphere graph."));
+	}
+
 	// -------------------------------------------------------------------------------------------
 	// First, we need the saliency map
 
@@ -248,12 +288,12 @@ void GBVS360::scanPath(const cv::Mat& imgBGR, cv::Mat &out, bool inputSaliencyMa
 	// -------------------------------------------------------------------------------------------
 	// prepare the state transition matrix
 
-	const cv::Mat &lx = grframe.lx;
+	const cv::Mat &lx = grframe->lx;
 
 	// form a multiresolution pyramid of feature maps according to multilevels
 	std::vector<cv::Mat> apyr;
 	std::vector< std::pair<int, int> > dims;
-	formMapPyramid(master_map, grframe.multilevels, apyr, dims);
+	formMapPyramid(master_map, grframe->multilevels, apyr, dims);
 
 	// assign a linear index to each node
 	std::vector<double> AL;
@@ -596,96 +636,81 @@ void GBVS360::getRectilinearFrames(const cv::Mat &inputImage) {
 	}
 
 
-	float scaling_x = 2;
-	float scaling_y = 1;
-
-
-	int nb_projections_w = static_cast<int>(std::ceil(360.f / static_cast<float>(m_Projection->nrApper/scaling_x)));
-	int nb_projections_h = static_cast<int>(std::ceil(180.f / static_cast<float>(m_Projection->nrApper/scaling_y)));
+	std::vector<TilePlanner::Centre> centres;
+	double aperture, feather;
+	TilePlanner::plan(*m_Projection, centres, aperture, feather);
 
 
-	// prepare all the projections: what needs to be done.
-	for(int j = -nb_projections_h / 2 ; j <= nb_projections_h/2 ; ++j) { // for(int j = -nb_projections_h / 2 -1 ; j <= nb_projections_h/2 + 1; ++j) {
-		for(int i = 0 ; i < nb_projections_w ; ++i) {
-
-			m_ProjectedFrames.push_back(ProjectedFrame());
-			ProjectedFrame &frame = m_ProjectedFrames.back();
-
-			frame.rectilinearFrame = cv::Mat(m_Projection->nrrHeight, m_Projection->nrrWidth, CV_8UC3, inputImage.channels());
-			if(frame.rectilinearFrame.empty()) {
-				throw std::logic_error(std::string("Saliency360::getRectilinearFrames bad alloc..."));
-				return ;
-			}
+	// prepare all the projections: what needs to be done. The rectilinear frames are only allocated 
+	// while their features are computed (see getRectilinearFeaturesJob).
+	for(size_t i = 0 ; i < centres.size() ; ++i) {
+		m_ProjectedFrames.push_back(ProjectedFrame());
+		ProjectedFrame &frame = m_ProjectedFrames.back();
 
-			// frame.nrElev = static_cast<int>(j * m_Projection->nrApper/scaling_x);
-			// frame.nrAzim = static_cast<int>(i * m_Projection->nrApper/scaling_y);
-			frame.nrAzim = static_cast<int>(i * m_Projection->nrApper/scaling_x);
-			frame.nrElev = static_cast<int>(j * m_Projection->nrApper/scaling_y);
-			frame.taskDone = false;
-		}
+		frame.nrAzim 	= centres[i].first;
+		frame.nrElev 	= centres[i].second;
+		frame.nrApper 	= aperture;
+		frame.nrFeather = feather;
 	}
+}
 
 
-	// Run `Option::threads` threads to do all the projections.
-	boost::thread_group group;
-	for(size_t i = 0 ; i < Option::threads ; ++i) {
-		group.create_thread(boost::bind(&GBVS360::getRectilinearFramesJob, this, boost::ref(inputImage)));
-	}
-	group.join_all();
-
 
-	// reset all task flags, to be ready for the next task
+void GBVS360::projectedFrames(std::vector<ProjectedFrame*> &frames) {
+	frames.clear();
 	for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-		it->taskDone = false;
+		frames.push_back(&(*it));
 	}
-
 }
 
 
 
-void GBVS360::getRectilinearFramesJob(const cv::Mat &inputImage) {
+void GBVS360::getRectilinearFrame(const cv::Mat &inputImage, const ProjectedFrame &projectedFrame, cv::Mat &rectilinearFrame) {
+	rectilinearFrame.create(m_Projection->nrrHeight, m_Projection->nrrWidth, CV_8UC3);
+	if(rectilinearFrame.empty()) {
+		throw std::logic_error(std::string("Saliency360::getRectilinearFrame bad alloc..."));
+	}
 
-	bool taskFound = true;
+	m_Projection->equirectangularToRectilinear(inputImage, rectilinearFrame, static_cast<float>(projectedFrame.nrAzim), static_cast<float>(projectedFrame.nrElev), 0.f, static_cast<float>(projectedFrame.nrApper));
 
-	while(taskFound) {
-		taskFound = false;
-		ProjectedFrame *projectedFrame = NULL;
-		m_mutex.lock();
-		int taskId = 0;
-		for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-			if(!it->taskDone) {
-				taskFound = true;
-				projectedFrame = &(*it);
+	if(hmdMode) {
+		HMDSim simulator;
+		cv::Mat result;
+		simulator.applyFilter(rectilinearFrame, result);
+		result = 255*result;
+		result.convertTo(rectilinearFrame, CV_8UC3);
+	}
+}
 
-				it->taskDone = true;		// marked the currently processed frame as estimated
-				break;
-			}
-			++taskId;
-		}
 
-		m_mutex.unlock();
+// -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- 
 
 
-		// if there is still something to do, do the job
-		if(taskFound) {
-			m_Projection->equirectangularToRectilinear(inputImage, projectedFrame->rectilinearFrame, static_cast<float>(projectedFrame->nrAzim), static_cast<float>(projectedFrame->nrElev));
+// forward the requested channels to the workers. S and P are computed in the equirectangular domain. The face 
+// detection runs in the workers, each thread having its own classifiers (see CascadePool).
+std::string GBVS360::workerChannels() {
+	bool segmentation = false;
+	bool linPerspective = false;
+	std::string workChannels;
+	for(size_t i = 0 ; i < channels.size() ; ++i) {
+		if(channels[i] != 'S'  &&  channels[i] != 'P') 
+			workChannels += channels[i];
+		else {
+			if(channels[i] =='S')
+				segmentation = true;
 
-			if(hmdMode) {
-				HMDSim simulator;
-				cv::Mat result;
-    			simulator.applyFilter(projectedFrame->rectilinearFrame, result);
-    			result = 255*result;
-    			result.convertTo(projectedFrame->rectilinearFrame, CV_8UC3);
-			}
+			if(channels[i] == 'P') 
+				linPerspective = true;
 		}
+			
 	}
-}
-
 
-// -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- 
+	channels = workChannels + (linPerspective ? "P" : "") + (segmentation ? "S" : "");	// make sure that S, P are in the last channel. 
+	return workChannels;
+}
 
 
-void GBVS360::getRectilinearFeatures	() {
+void GBVS360::getRectilinearFeatures	(const cv::Mat &inputImage) {
 	if(m_ProjectedFrames.empty()) return;
 
 	int maxLevel = 0;
@@ -697,35 +722,15 @@ void GBVS360::getRectilinearFeatures	() {
 	if(maxLevel == 0) return;
 
 	maxcomputelevel = maxLevel;
-	int height = static_cast<int>(m_ProjectedFrames.front().rectilinearFrame.rows / (maxLevel*featureScaling));
-	int width = static_cast<int>(m_ProjectedFrames.front().rectilinearFrame.cols  / (maxLevel*featureScaling));
-
-
-	bool faceDetection = false;
-	bool segmentation = false;
-	bool linPerspective = false;
-	std::string workChannels; // forward the requested channels to the workers. Unfortunately, Haarcascades classifiers does not seems to like multithreading. So, it will be needed to that in the main threads. 
-	for(size_t i = 0 ; i < channels.size() ; ++i) {
-		if(channels[i] != 'F' &&  channels[i] != 'S'  &&  channels[i] != 'P') 
-			workChannels += channels[i];
-		else {
-			if(channels[i] == 'F')
-				faceDetection = true;
-
-			if(channels[i] =='S')
-				segmentation = true;
+	int height = static_cast<int>(m_Projection->nrrHeight / (maxLevel*featureScaling));
+	int width = static_cast<int>(m_Projection->nrrWidth  / (maxLevel*featureScaling));
 
-			if(channels[i] == 'P') 
-				linPerspective = true;
-		}
-			
-	}
 
-	channels = workChannels + (linPerspective ? "P" : "") + (faceDetection ? "F" : "") + (segmentation ? "S" : "");	// make sure that F, S, P are in the last channel. 
+	std::string workChannels = workerChannels();
 
 	for(size_t i = m_GBVSWorkers.size() ; i < Option::threads ; ++i) {		// instantiate all the workers;
 		m_GBVSWorkers.push_back(boost::shared_ptr<GBVS>(new GBVS()));	
-		m_GBVSWorkers.back()->useCSF = false;
+		m_GBVSWorkers.back()->useCSF = Option::useCSF;
 		m_GBVSWorkers.back()->initDone = true;		// the workers will not generate saliency maps, no need to initialize the graph
 		m_GBVSWorkers.back()->maxcomputelevel = maxLevel; // we need to know what the deepest level. Normally this is estimated by initGBVS()
 		m_GBVSWorkers.back()->makeGaborFilters();	// we need the Gabor filter 
@@ -733,97 +738,33 @@ void GBVS360::getRectilinearFeatures	() {
 		m_GBVSWorkers.back()->salmapmaxsize_v.push_back(height);	
 		m_GBVSWorkers.back()->salmapmaxsize_v.push_back(width);
 		m_GBVSWorkers.back()->channels = workChannels;	
+		m_GBVSWorkers.back()->faceFeatureWeight = faceFeatureWeight;
+		m_GBVSWorkers.back()->faceDetectionSize = faceDetectionSize;
 
 	}
 
 
-	boost::thread_group group;
-	for(int i = 0 ; i < static_cast<int>(m_GBVSWorkers.size()) ; ++i) {
-		group.create_thread(boost::bind(&GBVS360::getRectilinearFeaturesJob, this, i));
-	}
-	group.join_all();
-
-
-	// Face detection was requested, we now do it in the main thread.
-	if(faceDetection) {
-		getFaceDetectionFeature(height, width);
-	}
-
-		
+	// one participant per worker: the slot of the participant gives its worker. Each task projects its 
+	// frame, computes the features and releases the frame, so only the frames in flight are in memory 
+	// and there is no barrier between the projections and the features.
+	std::vector<ProjectedFrame*> frames;
+	projectedFrames(frames);
+	ThreadPool::global().parallelFor(static_cast<int>(frames.size()), boost::bind(&GBVS360::getRectilinearFeaturesJob, this, boost::cref(inputImage), boost::cref(frames), _1, _2), static_cast<int>(m_GBVSWorkers.size()));
 }
 
 
-void GBVS360::getRectilinearFeaturesJob(int workerID) {
+void GBVS360::getRectilinearFeaturesJob(const cv::Mat &inputImage, const std::vector<ProjectedFrame*> &frames, int task, int workerID) {
 	boost::shared_ptr<GBVS> &saliency = m_GBVSWorkers[workerID];
+	ProjectedFrame *projectedFrame = frames[task];
 
+	cv::Mat rectilinearFrame;
+	getRectilinearFrame(inputImage, *projectedFrame, rectilinearFrame);
 
-	// look for a frame which need to be processed
-	bool taskFound = true;
-
-	while(taskFound) {
-		taskFound = false;
-		ProjectedFrame *projectedFrame = NULL;
-		m_mutex.lock();
-		for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-			if(!it->taskDone) {
-				taskFound = true;
-				projectedFrame = &(*it);
-
-				it->taskDone = true;		// marked the currently processed frame as estimated
-				break;
-			}
-		}
-
-		m_mutex.unlock();
-
-
-		// if there is still something to do, do the job
-		if(taskFound) {
-			saliency->computeFeatures(projectedFrame->rectilinearFrame);
-			projectedFrame->features = saliency->features;
-		} 
-	}
+	saliency->computeFeatures(rectilinearFrame);
+	projectedFrame->features = saliency->features;
 }
 
 
-// Do the face detection in the mean thread as the haarcascades classifiers does not like multi-threading... 
-void GBVS360::getFaceDetectionFeature(int height, int width) {
-
-	for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-		it->taskDone = true;		// marked the currently processed frame as estimated
-
-		ProjectedFrame *projectedFrame = &(*it);
-
-		int channelNumber = 0;
-		for(size_t i = 0 ; i < channels.size() ; ++i) {
-			if(channels[i] == 'F') {
-				break;
-			}
-			++channelNumber;
-		}
-
-		Feature f;
-		f.description = "Face detector";
-		f.weight = faceFeatureWeight;
-		f.channel = channelNumber;
-
-		cv::Mat featureMap = faceFeaturesDectection(projectedFrame->rectilinearFrame);
-
-		
-		if(!featureMap.empty()) {
-			FeatureMap fm;
-			fm.type  = 0;
-			fm.level = 0;
-			fm.channel = static_cast<int>(channels.size())-1;
-
-			cv::resize(featureMap, fm.map, cv::Size(width, height), 0, 0, cv::INTER_AREA);
-			f.maps.push_back(fm);
-
-			projectedFrame->features.push_back(f);
-		}
-	}
-}
-
 void GBVS360::getSegmentationFeature(const cv::Mat &inputImage, Feature &segFeature) {
 	cv::Mat input = inputImage.clone();
 	input.convertTo(input, CV_64FC3);
@@ -886,16 +827,36 @@ void GBVS360::getLinPerFeature(const cv::Mat &inputImage, Feature &linPerFeature
 	linPerFeature.channel = fm.channel;
 }
 
+static void remapTableJob(const std::vector<RemapTable::Geometry> &geometries, std::vector< boost::shared_ptr<const RemapTable> > &tables, int task) {
+	tables[task] = RemapTable::get(geometries[task]);
+}
+
+// the maps of a feature computed in the equirectangular domain, taken at the nodes of the sphere grid
+static void sampleOnSphere(const SphereGraph &sphere, Feature &feature) {
+	for(std::list<FeatureMap>::iterator it = feature.maps.begin() ; it != feature.maps.end() ; ++it) {
+		cv::Mat image, nodes;
+		it->map.convertTo(image, CV_64FC1);
+		sphere.sample(image, nodes);
+		it->map = nodes;
+	}
+}
+
 void GBVS360::getEquirectangularFeatures() {
 
 	if(m_ProjectedFrames.empty()) { std::cout << "[I] No projected frames... " << std::endl; return; } 					// If there are no frames available, stop.
 	ProjectedFrame &frame = *m_ProjectedFrames.begin(); 	
 	if(frame.features.empty()) { std::cout << "[I] No features" << std::endl; return; };						// If there are no features computed, stop.
 
-	int mxType = 0;
-	int mxLevel = 0;
-	int mxChannel = 0;
-	// allocate enough memory for all features in equirectangular domain.
+	// allocate enough memory for all features in equirectangular domain, or on the nodes of the sphere 
+	// grid (N x 1). The maps are grouped by the resolution of their rectilinear version: with the packed 
+	// back-projection, each group (split in as many tasks as threads) is back-projected in one pass. 
+	// Otherwise each feature map is a task.
+	boost::shared_ptr<const SphereGraph> 			sphere;
+	if(Option::sphereGraph > 0)
+		sphere = SphereGraph::get(Option::sphereGraph);
+
+	std::list<FeatureMap*> 							targets;
+	std::map< std::pair<int, int>, std::vector<FeatureMap*> > 	groups;
 	for(std::list<Feature>::iterator it = frame.features.begin() ; it != frame.features.end() ; ++it) {
 		features.push_back(Feature());
 		features.back().weight 		= it->weight;
@@ -911,41 +872,124 @@ void GBVS360::getEquirectangularFeatures() {
 			// the interpolation in the projection function needs an image in with a power of 2.
 			int rows = 4 * (static_cast<int>(m_EquirectangularFrameSize.height / (maxcomputelevel*featureScaling)) / 4); // 0
 			int cols = 4 * (static_cast<int>(m_EquirectangularFrameSize.width / (maxcomputelevel*featureScaling)) / 4); // 1
+			if(sphere) {
+				rows = sphere->size();
+				cols = 1;
+			}
 
 			features.back().maps.back().map = cv::Mat(rows, cols, CV_64FC1, cv::Scalar(0));
 
-			mxType = std::max(mxType, mapIt->type);
-			mxLevel = std::max(mxLevel, mapIt->level);
-			mxChannel = std::max(mxChannel, mapIt->channel);
+			groups[std::make_pair(mapIt->map.rows, mapIt->map.cols)].push_back(&features.back().maps.back());
+			targets.push_back(&features.back().maps.back());
+		}
+	}
+
+	std::vector<BackProjection> 		backProjections;
+	if(Option::backProjection == 2) {
+		size_t threads = std::max<size_t>(Option::threads, 1);
+		size_t chunk   = std::max<size_t>(1, std::min<size_t>((targets.size() + threads - 1) / threads, CV_CN_MAX));
+
+		for(std::map< std::pair<int, int>, std::vector<FeatureMap*> >::const_iterator it = groups.begin() ; it != groups.end() ; ++it) {
+			for(size_t i = 0 ; i < it->second.size() ; i += chunk) {
+				backProjections.push_back(BackProjection());
+				backProjections.back().targets.assign(it->second.begin() + i, it->second.begin() + std::min(i + chunk, it->second.size()));
+			}
+		}
+	} else {
+		for(std::list<FeatureMap*>::const_iterator it = targets.begin() ; it != targets.end() ; ++it) {
+			backProjections.push_back(BackProjection());
+			backProjections.back().targets.push_back(*it);
+		}
+	}
+
+	std::map<MapKey, std::pair<size_t, size_t> > 	backProjectionIndex;		// back-projection, slot
+	for(size_t i = 0 ; i < backProjections.size() ; ++i) {
+		for(size_t k = 0 ; k < backProjections[i].targets.size() ; ++k) {
+			const FeatureMap *target = backProjections[i].targets[k];
+			backProjectionIndex[MapKey(target->channel, std::make_pair(target->level, target->type))] = std::make_pair(i, k);
+		}
+		backProjections[i].sources.resize(m_ProjectedFrames.size(), std::vector<const cv::Mat*>(backProjections[i].targets.size(), NULL));
+		backProjections[i].tables.resize(m_ProjectedFrames.size(), NULL);
+	}
+
+	// the maps of each frame are dispatched to their back-projection in one pass, with the geometry of 
+	// their remap table
+	std::vector<RemapTable::Geometry> 				geometries;
+	std::map<RemapTable::Geometry, size_t> 			geometryIndex;
+	std::vector< std::vector<size_t> > 				sourceGeometries(backProjections.size(), std::vector<size_t>(m_ProjectedFrames.size(), 0));
+	size_t 											frameIdx = 0;
+	for(std::list< ProjectedFrame >::const_iterator projIt = m_ProjectedFrames.begin() ; projIt != m_ProjectedFrames.end() ; ++projIt, ++frameIdx) {
+		for(std::list<Feature>::const_iterator featureIt = projIt->features.begin() ; featureIt != projIt->features.end() ; ++featureIt) {
+			for(std::list< FeatureMap >::const_iterator mapIt = featureIt->maps.begin() ; mapIt != featureIt->maps.end() ; ++mapIt) {
+				if(featureIt->channel != mapIt->channel) continue;
+
+				std::map<MapKey, std::pair<size_t, size_t> >::const_iterator index = backProjectionIndex.find(MapKey(mapIt->channel, std::make_pair(mapIt->level, mapIt->type)));
+				if(index == backProjectionIndex.end()) continue;
+
+				BackProjection &backProjection = backProjections[index->second.first];
+				const cv::Mat &target = backProjection.targets[index->second.second]->map;
+
+				RemapTable::Geometry geometry;
+				geometry.tileWidth 	= mapIt->map.cols;
+				geometry.tileHeight = mapIt->map.rows;
+				geometry.width 		= target.cols;
+				geometry.height 	= target.rows;
+				geometry.azim 		= static_cast<float>(projIt->nrAzim);
+				geometry.elev 		= static_cast<float>(projIt->nrElev);
+				geometry.roll 		= 0.f;
+				geometry.aperture 	= static_cast<float>(projIt->nrApper);
+				geometry.feather 	= static_cast<float>(projIt->nrFeather);
+				geometry.sphere 	= sphere ? sphere->subdivisions() : 0;
+
+				std::map<RemapTable::Geometry, size_t>::const_iterator geometryIt = geometryIndex.find(geometry);
+				if(geometryIt == geometryIndex.end()) {
+					geometryIt = geometryIndex.insert(std::make_pair(geometry, geometries.size())).first;
+					geometries.push_back(geometry);
+				}
+
+				backProjection.sources[frameIdx][index->second.second] = &mapIt->map;
+				sourceGeometries[index->second.first][frameIdx] = geometryIt->second;
+			}
 		}
 	}
 
+	// the remap tables of the frames are built in parallel, or taken from the previous images
+	std::vector< boost::shared_ptr<const RemapTable> > tables(geometries.size());
+	ThreadPool::global().parallelFor(static_cast<int>(geometries.size()), boost::bind(&remapTableJob, boost::cref(geometries), boost::ref(tables), _1), static_cast<int>(Option::threads));
 
-	// add flags to know if a feature was projected to equirectangular domain.
-	// order is : featureDone[CHANNEL][LEVEL][TYPE]
-	featureDone.clear();
-	++mxChannel; ++mxLevel; ++mxType;
-	featureDone.resize(mxChannel);
-	for(int i = 0 ; i < mxChannel ; ++i) {
-		featureDone[i].resize(mxLevel);
-		for(int j = 0 ; j < mxLevel ; ++j) {
-			featureDone[i][j].resize(mxType, false);
+	for(size_t i = 0 ; i < backProjections.size() ; ++i) {
+		for(size_t k = 0 ; k < m_ProjectedFrames.size() ; ++k) {
+			for(size_t l = 0 ; l < backProjections[i].sources[k].size() ; ++l) {
+				if(backProjections[i].sources[k][l] == NULL)
+					throw std::logic_error(std::string("GBVS360::getEquirectangularFeatures(): a projected frame misses a feature map."));
+			}
+			backProjections[i].tables[k] = tables[sourceGeometries[i][k]].get();
 		}
 	}
 
-	// Run `Option::threads` threads to do all the projections.
-	boost::thread_group group;
-	for(size_t i = 0 ; i < Option::threads ; ++i) {
-		group.create_thread(boost::bind(&GBVS360::getEquirectangularFeaturesJob, this));
+	std::vector<ThreadPool::Task> tasks;
+	for(size_t i = 0 ; i < backProjections.size() ; ++i) {
+		tasks.push_back(boost::bind(&GBVS360::getEquirectangularFeaturesJob, this, boost::cref(backProjections[i])));
 	}
 
 
+	invokeWithEquirectangularChannels(tasks);
+}
+
+
+// runs the tasks of the front-end together with the features computed directly in equirectangular domain (S 
+// and P), and adds these features
+void GBVS360::invokeWithEquirectangularChannels(std::vector<ThreadPool::Task> &tasks) {
+	boost::shared_ptr<const SphereGraph> 			sphere;
+	if(Option::sphereGraph > 0)
+		sphere = SphereGraph::get(Option::sphereGraph);
+
 	// if the feature S is requested, we compute it directly in equirectangular domain.
 	bool doSegmentation = false;
 	Feature segFeature;
 	for(size_t i = 0 ; i < channels.size() && !doSegmentation ; ++i) {
 		if(channels[i] == 'S') {
-			group.create_thread(boost::bind(&GBVS360::getSegmentationFeature, this, boost::ref(m_InputImage), boost::ref(segFeature)));
+			tasks.push_back(boost::bind(&GBVS360::getSegmentationFeature, this, boost::cref(m_InputImage), boost::ref(segFeature)));
 			doSegmentation = true;
 		}
 	}
@@ -956,20 +1000,27 @@ void GBVS360::getEquirectangularFeatures() {
 	for(size_t i = 0 ; i < channels.size() && !doPerspective ; ++i) {
 		if(channels[i] == 'P') {
 			//getLinPerFeature(m_InputImage, linPerFeature);
-			group.create_thread(boost::bind(&GBVS360::getLinPerFeature, this, boost::ref(m_InputImage), boost::ref(linPerFeature)));
+			tasks.push_back(boost::bind(&GBVS360::getLinPerFeature, this, boost::cref(m_InputImage), boost::ref(linPerFeature)));
 			doPerspective = true;
 		}
 	}
 
 
-	group.join_all();
+	// Run the tasks on the pool, with `Option::threads` participants.
+	ThreadPool::global().invoke(tasks, static_cast<int>(Option::threads));
 
 	// add the segmentation feature maps which was estimated in parallel.
 	if(doSegmentation) {
+		if(sphere)
+			sampleOnSphere(*sphere, segFeature);
+
 		features.push_back(segFeature);
 	}
 
 	if(doPerspective) {
+		if(sphere)
+			sampleOnSphere(*sphere, linPerFeature);
+
 		double mx, mn;
 		cv::minMaxLoc(linPerFeature.maps.back().map, &mn, &mx);
 		if(mx > 0.1) {
@@ -981,150 +1032,177 @@ void GBVS360::getEquirectangularFeatures() {
 }
 
 
-void GBVS360::getEquirectangularFeaturesJob() {
-
-	bool taskFound = true;
-	while(taskFound) {
-		taskFound = false;
-
-		// algo v1, easy, without packing of multiple features with the same resolution to save computational costs...
-		if(m_ProjectedFrames.empty()) break; 					// If there are no frames available, stop.
-		ProjectedFrame &frame = *m_ProjectedFrames.begin(); 	
-		if(frame.features.empty()) break;						// If there are no features computed, stop.
-
-
+// -------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------- 
+// equirectangular front-end: the features are extracted from the whole image, with kernels following the 
+// latitude (see EquirectangularGBVS), instead of the projected frames.
 
-		int channel = 0;
-		int level = 0;
-		int type = 0;
+void GBVS360::getEquirectangularNativeFeatures(const cv::Mat &inputImage) {
+	int maxLevel = 0;
+	for(size_t i = 0 ; i < levels.size() ; ++i) {
+		if(levels[i] > maxLevel)
+			maxLevel = levels[i];
+	}
 
-		// ----------------------------------------------------------------------------------
-		// identify what task need to be done
+	if(maxLevel == 0) return;
 
+	maxcomputelevel = maxLevel;
 
-		m_mutex.lock();
-		
-		// iterate each feature channel
-		for(std::list<Feature>::iterator it = frame.features.begin() ; it != frame.features.end() && !taskFound ; ++it) {
-			// iterate each feature map
-			for(std::list< FeatureMap >::iterator mapIt = it->maps.begin() ; mapIt != it->maps.end()  && !taskFound ; ++mapIt) {
-				if(!featureDone[mapIt->channel][mapIt->level][mapIt->type]) {
-
-					// we found one feature map which needs to be back projected. 
-					channel = mapIt->channel;
-					level = mapIt->level;
-					type = mapIt->type;
-
-					// we mark it as `done`, e.g. in progress...
-					featureDone[mapIt->channel][mapIt->level][mapIt->type] = true;
-
-					// a task was found.
-					taskFound = true;
-				}
+	// same resolution as the back-projected maps of the projected frames
+	int rows = 4 * (static_cast<int>(m_EquirectangularFrameSize.height / (maxLevel*featureScaling)) / 4);
+	int cols = 4 * (static_cast<int>(m_EquirectangularFrameSize.width / (maxLevel*featureScaling)) / 4);
+
+	EquirectangularGBVS worker;
+	worker.useCSF = Option::useCSF;
+	worker.initDone = true;					// no saliency map, the graph is not needed
+	worker.maxcomputelevel = maxLevel;
+	worker.makeGaborFilters();
+	worker.salmapmaxsize_v.clear();
+	worker.salmapmaxsize_v.push_back(rows);
+	worker.salmapmaxsize_v.push_back(cols);
+	worker.channels = workerChannels();
+	worker.faceFeatureWeight = faceFeatureWeight;
+	worker.faceDetectionSize = faceDetectionSize;
+
+	std::vector<ThreadPool::Task> tasks;
+	tasks.push_back(boost::bind(&GBVS::computeFeatures, &worker, boost::cref(inputImage)));
+
+	invokeWithEquirectangularChannels(tasks);
+
+	boost::shared_ptr<const SphereGraph> sphere;
+	if(Option::sphereGraph > 0)
+		sphere = SphereGraph::get(Option::sphereGraph);
+
+	for(std::list<Feature>::iterator it = worker.features.begin() ; it != worker.features.end() ; ++it) {
+		if(sphere) {
+			sampleOnSphere(*sphere, *it);
+		} else {
+			for(std::list<FeatureMap>::iterator mapIt = it->maps.begin() ; mapIt != it->maps.end() ; ++mapIt) {
+				cv::Mat map;
+				cv::resize(mapIt->map, map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
+				mapIt->map = map;
 			}
 		}
+	}
 
-		m_mutex.unlock();
-
-		// if nothing to do, then close the thread.
-		if(!taskFound) {
-			return;
-		}
-
-		// ----------------------------------------------------------------------------------
-		// back-project the identified feature map.
-
-
+	// the features of the worker come before S and P
+	features.splice(features.begin(), worker.features);
+}
 
-		// Find the feature map between the equirectilinear maps
-		for(std::list<Feature>::iterator featureItEquirect = features.begin() ; featureItEquirect != features.end() ; ++featureItEquirect) {
-			if(featureItEquirect->channel != channel) continue; // if we are not on the right channel, no need to check the maps
 
-			// iterate each feature map
-			for(std::list< FeatureMap >::iterator mapItEquirectilinear = featureItEquirect->maps.begin() ; mapItEquirectilinear != featureItEquirect->maps.end() ; ++mapItEquirectilinear) {
-				if(mapItEquirectilinear->level == level && mapItEquirectilinear->type == type && mapItEquirectilinear->channel == channel) {
+void GBVS360::getEquirectangularFeaturesJob(const BackProjection &backProjection) {
 
+	// ----------------------------------------------------------------------------------
+	// back-project the feature maps (channel, level, type) of each frame, by gathering through the 
+	// remap table of the frame. The maps of the back-projection are packed in the channels of one 
+	// image, and share the coverage of the frame.
 
-					cv::Mat nbProj(mapItEquirectilinear->map.rows, mapItEquirectilinear->map.cols, CV_8UC1, cv::Scalar(0));
+	const int 	nbMaps = static_cast<int>(backProjection.targets.size());
+	const cv::Mat &first = backProjection.targets.front()->map;
 
-					for(std::list< ProjectedFrame >::iterator projIt = m_ProjectedFrames.begin() ; projIt != m_ProjectedFrames.end() ; ++projIt) {
-						
+	cv::Mat target(first.rows, first.cols, CV_64FC(nbMaps), cv::Scalar::all(0));
+	cv::Mat weights(first.rows, first.cols, CV_64FC1, cv::Scalar(0));
 
+	cv::Mat packed;
+	std::vector<cv::Mat> planes(nbMaps);
+	for(size_t k = 0 ; k < backProjection.sources.size() ; ++k) {
+		if(nbMaps == 1) {
+			packed = *backProjection.sources[k][0];
+		} else {
+			for(int c = 0 ; c < nbMaps ; ++c) {
+				planes[c] = *backProjection.sources[k][c];
+			}
+			cv::merge(planes, packed);
+		}
 
+		backProjection.tables[k]->accumulate(packed, target, weights);
+	}
 
-						// Find the feature map between the equilinear maps
-						for(std::list<Feature>::iterator featureIt = projIt->features.begin() ; featureIt != projIt->features.end() ; ++featureIt) {
+	if(nbMaps == 1) {
+		planes[0] = target;
+	} else {
+		cv::split(target, planes);
+	}
 
-							if(featureIt->channel != channel) continue; // if we are not on the right channel, no need to check the maps
+	for(int c = 0 ; c < nbMaps ; ++c) {
+		cv::Mat &plane = planes[c];
+		for(int i = 0 ; i < plane.rows ; ++i) {
+			for(int j = 0 ; j < plane.cols ; ++j) {
+				double w = weights.at<double>(i,j);
 
-							// iterate each feature map
-							for(std::list< FeatureMap >::iterator mapItEquilinear = featureIt->maps.begin() ; mapItEquilinear != featureIt->maps.end() ; ++mapItEquilinear) {
-								
-								if((mapItEquilinear->level == level && mapItEquilinear->type == type && mapItEquilinear->channel == channel)) {
+				// not covered by any frame (or only by their feathered edges): no feature
+				if(w <= 0) {
+					plane.at<double>(i,j) = 0;
+					continue;
+				}
 
-									cv::Mat tempEquirect(mapItEquirectilinear->map.rows, mapItEquirectilinear->map.cols, CV_32FC3, cv::Scalar(0.f,0.f,0.f));
-									cv::Mat floatFeature(mapItEquilinear->map.rows, mapItEquilinear->map.cols, CV_32FC3, cv::Scalar(0.f,0.f,0.f));
+				plane.at<double>(i,j) /= w;
+			}
+		}
 
-									for(int i = 0 ; i < mapItEquilinear->map.rows ; ++i) {
-										for(int j = 0 ; j < mapItEquilinear->map.cols ; ++j) {
-											cv::Point3_<float> &dst = floatFeature.at< cv::Point3_<float> >(i,j);
-											dst.x = static_cast<float>(mapItEquilinear->map.at<double>(i,j));
-											dst.y = 1;
-											dst.z = 0;
-										}
-									}
+		// the nodes of the sphere grid are already the nodes of the graph
+		if(Option::sphereGraph > 0)
+			plane.copyTo(backProjection.targets[c]->map);
+		else
+			cv::resize(plane, backProjection.targets[c]->map, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
+	}
+}
 
 
-									m_Projection->rectilinearToEquirectangularFC3(floatFeature, tempEquirect, static_cast<float>(projIt->nrAzim), static_cast<float>(projIt->nrElev));
+// ----------------------------------------------------------------------------------------------------------------------------------------------------
+// redefine GBVS functions 
 
-									for(int i = 0 ; i < tempEquirect.rows ; ++i) {
-										for(int j = 0 ; j < tempEquirect.cols ; ++j) {
-											cv::Point3_<float> &src = tempEquirect.at< cv::Point3_<float> >(i,j);
 
-											// if that is not part of the feature, skip
-											if(src.y < 0.999f) continue;
+// with the sphere graph, the activation runs on the nodes of the icosahedral grid. The distances are 
+// scaled to the pixels of the saliency map, as with the equirectangular graph.
+void GBVS360::graphsalinit(const std::vector<int> &map_size) {
+	if(Option::sphereGraph <= 0) {
+		GBVS::graphsalinit(map_size);
+		return;
+	}
 
-											double v = mapItEquirectilinear->map.at<double>(i,j);
+	grframe = FrameCache::get("sphere:" + boost::lexical_cast<std::string>(Option::sphereGraph) + ";" + frameKey(map_size), boost::bind(&GBVS360::buildSphereFrame, this, boost::cref(map_size), _1));
+}
 
-											v += src.x;
 
-											++nbProj.at<unsigned char>(i,j);
+void GBVS360::buildSphereFrame(const std::vector<int> &map_size, Frame &frame) const {
+	// same cutoff as GBVS::buildFrame()
+	double sig = std::max(sigma_frac_act, sigma_frac_norm) * static_cast<double>(map_size[0] + map_size[1])/2.f;
+	double maxDistance = std::numeric_limits<double>::max();
+	if(sparseGraph && sparseCutoff > 0)
+		maxDistance = -2 * sig*sig * std::log(sparseCutoff);
 
-											mapItEquirectilinear->map.at<double>(i,j) = v;
+	SphereGraph::get(Option::sphereGraph)->buildFrame(map_size, Option::distScaling, sparseGraph, maxDistance, frame);
+}
 
-										}
-									} 
-								}
-							}
-						}
 
-					} // end loop projIt
+// the master map on the nodes is rendered on the equirectangular saliency map, before the blur
+void GBVS360::renderMasterMap() {
+	if(Option::sphereGraph <= 0) return;
 
+	cv::Mat image(salmapmaxsize_v[0], salmapmaxsize_v[1], CV_64FC1);
+	SphereGraph::get(Option::sphereGraph)->render(master_map, image);
+	master_map = image;
+}
 
-					for(int i = 0 ; i < mapItEquirectilinear->map.rows ; ++i) {
-						for(int j = 0 ; j < mapItEquirectilinear->map.cols ; ++j) {
-							mapItEquirectilinear->map.at<double>(i,j) /= nbProj.at<unsigned char>(i,j);
-						}
-					}
 
-					cv::Mat tmp;
-					cv::resize(mapItEquirectilinear->map, tmp, cv::Size(salmapmaxsize_v[1], salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
-					mapItEquirectilinear->map = tmp;
-				}
-			}
-		}
+std::string GBVS360::distanceModel() const {
+	return "equirectangular:" + boost::lexical_cast<std::string>(Option::distScaling);
+}
 
 
+double GBVS360::nodedistance(const std::pair<int, int>& dim, int , int a, int b) const {
+	return Option::distScaling * GBVS::nodedistance(dim, 0, a, b);
+}
 
-	} // end while task
 
+int GBVS360::nodereach(const std::pair<int, int>& dim, int , double maxDistance) const {
+	if(Option::distScaling <= 0)
+		return std::max(dim.first, dim.second);
 
+	return GBVS::nodereach(dim, 0, maxDistance / Option::distScaling);
 }
 
 
-// ----------------------------------------------------------------------------------------------------------------------------------------------------
-// redefine GBVS functions 
-
 cv::Mat GBVS360::simpledistance	(const std::pair<int, int>& dim, int ) const {
 
 	return Option::distScaling * GBVS::simpledistance(dim, 0);
@@ -1209,12 +1287,7 @@ const cv::Mat * GBVS360::findMap(char channel, int level, int type) const {
 
 	if(channelId == -1) return NULL;
 
-	for(std::list<FeatureMap>::const_iterator it = allmaps.begin() ; it != allmaps.end() ; ++it) {
-		if(it->channel == channelId && it->type == type && it->level == level) 
-			return &it->map;
-	}
-
-	return NULL;
+	return activationTensor.find(channelId, level, type);
 }
 
 
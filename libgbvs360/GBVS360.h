@@ -28,21 +28,24 @@
 #define _GBVS360_
 
 #include <GBVS.h>
+#include <ThreadPool.h>
 
 #include <boost/shared_ptr.hpp>
-#include <boost/thread/mutex.hpp>
 
 class Projection;
+class RemapTable;
 
 
 
 struct ProjectedFrame {
-	cv::Mat 					rectilinearFrame;
+	cv::Mat 					rectilinearFrame;	// only kept by ProjectedSaliency, between its projection and saliency passes.
+													// GBVS360 streams its frames (see getRectilinearFrame) and leaves it empty.
 	cv::Mat 					saliency;
 	std::list<Feature> 			features;
 	int 						nrElev;
 	int 						nrAzim;
-	bool						taskDone;
+	double 						nrApper;		// degrees
+	double 						nrFeather;		// band blended with the neighbouring frames (see RemapTable), 0 for none
 } ;
 
 
@@ -58,12 +61,19 @@ class GBVS360 : public GBVS {
 
 private:
 
+	// equirectangular feature maps back-projected together (one, or all the maps with the same resolution 
+	// when they are packed), their maps in each projected frame and the remap table of the frame
+	typedef std::pair< int, std::pair<int, int> > 	MapKey;			// channel, level, type
+	struct BackProjection {
+		std::vector<FeatureMap*> 					targets;
+		std::vector< std::vector<const cv::Mat*> > 	sources;		// [frame][target]
+		std::vector<const RemapTable*> 				tables;			// [frame]
+	};
+
 	cv::Mat												m_InputImage;
 	boost::shared_ptr<Projection> 						m_Projection;
 	std::vector< boost::shared_ptr<GBVS> > 				m_GBVSWorkers;
-	boost::mutex										m_mutex;
 	std::list<ProjectedFrame> 							m_ProjectedFrames;
-	std::vector< std::vector< std::vector< bool > > > 	featureDone; 
 	cv::Size 											m_EquirectangularFrameSize;
 
 
@@ -87,6 +97,7 @@ public:
 
 
 	virtual void 	compute 				(const cv::Mat& imgBGR, cv::Mat &out, bool normalize = true);
+	virtual void 	computeFeatures 		(const cv::Mat& imgBGR);
 	virtual void 	scanPath				(const cv::Mat& input, cv::Mat &out, bool inputSaliencyMap = false);
 
 
@@ -95,14 +106,22 @@ public:
 
 private:
 
+	void 			getFeatures				(const cv::Mat &inputImage);
+	std::string 	workerChannels			();
+	void 			projectedFrames			(std::vector<ProjectedFrame*> &frames);
+
 	void 			getRectilinearFrames	(const cv::Mat &inputImage);
-	void			getRectilinearFramesJob	(const cv::Mat &inputImage);
+	void			getRectilinearFrame		(const cv::Mat &inputImage, const ProjectedFrame &projectedFrame, cv::Mat &rectilinearFrame);
 
 
-	void 			getRectilinearFeatures	     ();
-	void			getRectilinearFeaturesJob 	 (int workerID);
+	void 			getRectilinearFeatures	     (const cv::Mat &inputImage);
+	void			getRectilinearFeaturesJob 	 (const cv::Mat &inputImage, const std::vector<ProjectedFrame*> &frames, int task, int workerID);
 	void 			getEquirectangularFeatures   ();
-	void			getEquirectangularFeaturesJob();
+	void			getEquirectangularFeaturesJob(const BackProjection &backProjection);
+	void 			getEquirectangularNativeFeatures(const cv::Mat &inputImage);
+	void 			invokeWithEquirectangularChannels(std::vector<ThreadPool::Task> &tasks);
+
+	void 			buildSphereFrame			 (const std::vector<int> &map_size, Frame &frame) 				const;
 
 
 	cv::Mat 		runScanPath 				(const cv::Mat& saliency, const cv::Mat& imgBGR, const std::vector<FixationOption>& groundTruthFixations, const cv::Mat &lx, const cv::Mat &mm, int initPosition);
@@ -112,7 +131,6 @@ protected:
 // ----------------------------------------------------------------------------------------------------------------------
 // compute features from GBVS360
 
-	void 			getFaceDetectionFeature		 (int height, int width);
 	void 			getSegmentationFeature		 (const cv::Mat &inputImage, Feature &segFeature);
 	void 			getLinPerFeature 			 (const cv::Mat &inputImage, Feature &linPerFeature);
 
@@ -120,8 +138,13 @@ protected:
 // redefine GBVS functions 
 
 
+	virtual void graphsalinit				(const std::vector<int> &map_size);
+	virtual void renderMasterMap			();
 	virtual void attenuateBordersGBVS	 	(cv::Mat &map, int borderSize) 										const;
 	virtual cv::Mat simpledistance				(const std::pair<int, int>& dim, int cyclic_type) 				const;
+	virtual double 	nodedistance				(const std::pair<int, int>& dim, int cyclic_type, int a, int b) const;
+	virtual int 	nodereach 					(const std::pair<int, int>& dim, int cyclic_type, double maxDistance) const;
+	virtual std::string distanceModel			() 																const;
 
 	const cv::Mat *	findMap						 (char channel, int level, int type) 							const ;
 } ;
@@ -25,12 +25,21 @@
 
 
 #include "GBVSSaliency.h"
+#include "Options.h"
 
 
 GBVSSaliency::GBVSSaliency() {
 	m_GBVS = boost::shared_ptr<GBVS>(new GBVS());
-	m_GBVS->useCSF = false;
+	m_GBVS->useCSF = Option::useCSF;
 	m_GBVS->nbThreads = 1;
+	m_GBVS->sparseGraph = Option::sparseGraphCutoff > 0;
+	m_GBVS->sparseCutoff = Option::sparseGraphCutoff;
+	m_GBVS->graphEngine = Option::graphEngine;
+	m_GBVS->activationBatch = Option::activationBatch;
+	m_GBVS->singlePrecision = Option::singlePrecision;
+	m_GBVS->eigenSolver = Option::eigenSolver;
+	m_GBVS->warmStart = Option::warmStart;
+	m_GBVS->reportIterations = Option::reportIterations;
 }
 
 void GBVSSaliency::setBlurFrac(float blurfrac) {
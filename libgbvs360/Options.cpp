@@ -38,6 +38,20 @@ int Option::numberFixations  = 40;
 int Option::experimentLength = 25;
 int Option::experimentRepppetition = 40;
 float Option::distScaling = 1.f;
+double Option::sparseGraphCutoff = 0;
+int Option::graphEngine = 1;
+int Option::activationBatch = 1;
+bool Option::singlePrecision = false;
+int Option::eigenSolver = 1;
+bool Option::warmStart = false;
+bool Option::reportIterations = false;
+bool Option::useCSF = false;
+int Option::backProjection = 2;
+int Option::tiling = 1;
+double Option::tileOverlap = 0.2;
+double Option::cubeGuardBand = 0.1;
+int Option::sphereGraph = 0;
+int Option::featureFrontEnd = 1;
 
 // export raw features for training the pooling using R
 bool		Option::exportRawFeatures = false;
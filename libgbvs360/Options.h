@@ -44,6 +44,48 @@ struct Option {
 
 	static float distScaling;
 
+	// weight cutoff of the sparse graph used by the GBVS activation. 0 keeps the dense graph.
+	static double sparseGraphCutoff;
+
+	// 1: the markov matrix of the activation is built, 2: matrix-free markov chain
+	static int graphEngine;
+
+	// number of feature maps solved together by an activation job (matrix-free engine only)
+	static int activationBatch;
+
+	// the markov chains of the activation are computed in float (matrix-free engine only)
+	static bool singlePrecision;
+
+	// eigenvector solver of the activation: 1) power iterations, 2) with Aitken extrapolation (matrix-free engine only)
+	static int eigenSolver;
+
+	// the eigenvector iterations start from the map instead of the uniform vector (matrix-free engine only)
+	static bool warmStart;
+
+	// print the number of iterations of the activation of each map
+	static bool reportIterations;
+
+	// back-projection of the feature maps: 1) each map on its own, 2) the maps with the same resolution are packed
+	static int backProjection;
+
+	// centres of the projected frames: 1) regular azimuth x elevation grid, 2) Fibonacci spiral, 3) cube map (see TilePlanner)
+	static int tiling;
+
+	// part of the frames overlapping their neighbours with the spiral tiling, in the tangent plane
+	static double tileOverlap;
+
+	// guard band of the faces of the cube map, as a ratio of the half face
+	static double cubeGuardBand;
+
+	// graph of the activation: 0) the equirectangular grid, k > 0) the icosahedral grid of the sphere with k subdivisions (see SphereGraph)
+	static int sphereGraph;
+
+	// feature extraction: 1) on the projected frames, 2) on the whole equirectangular image, with kernels widened with the latitude (see EquirectangularGBVS)
+	static int featureFrontEnd;
+
+	// the contrast sensitivity function is applied to the luminance of the GBVS workers
+	static bool useCSF;
+
 
 	// export raw features for training the pooling using R
 	static bool exportRawFeatures;
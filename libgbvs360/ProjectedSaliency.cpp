@@ -32,8 +32,11 @@
 #include <limits>
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
+#include <ThreadPool.h>
 
 #include "Projection.h"
+#include "TilePlanner.h"
+#include "RemapTable.h"
 #include "Options.h"
 
 
@@ -113,79 +116,45 @@ void ProjectedSaliency::getRectilinearFrames(const cv::Mat &inputImage) {
 	}
 
 
-	float scaling_x = 2;
-	float scaling_y = 1;
-
-
-	int nb_projections_w = static_cast<int>(std::ceil(360.f / static_cast<float>(m_Projection->nrApper/scaling_x)));
-	int nb_projections_h = static_cast<int>(std::ceil(180.f / static_cast<float>(m_Projection->nrApper/scaling_y)));
+	std::vector<TilePlanner::Centre> centres;
+	double aperture, feather;
+	TilePlanner::plan(*m_Projection, centres, aperture, feather);
 
 
 	// prepare all the projections: what needs to be done.
-	for(int j = -nb_projections_h / 2  ; j <= nb_projections_h/2 ; ++j) {
-		for(int i = 0 ; i < nb_projections_w ; ++i) {
-
-			m_ProjectedFrames.push_back(ProjectedFrame());
-			ProjectedFrame &frame = m_ProjectedFrames.back();
-
-			frame.rectilinearFrame = cv::Mat(m_Projection->nrrHeight, m_Projection->nrrWidth, CV_8UC3, inputImage.channels());
-			if(frame.rectilinearFrame.empty()) {
-				throw std::logic_error(std::string("getRectilinearFrames::getEquilinarFrames bad alloc..."));
-				return ;
-			}
-
-			frame.nrElev = static_cast<int>(j * m_Projection->nrApper/scaling_y);
-			frame.nrAzim = static_cast<int>(i * m_Projection->nrApper/scaling_x);
-			frame.taskDone = false;
+	for(size_t i = 0 ; i < centres.size() ; ++i) {
+		m_ProjectedFrames.push_back(ProjectedFrame());
+		ProjectedFrame &frame = m_ProjectedFrames.back();
+
+		frame.rectilinearFrame = cv::Mat(m_Projection->nrrHeight, m_Projection->nrrWidth, CV_8UC3, inputImage.channels());
+		if(frame.rectilinearFrame.empty()) {
+			throw std::logic_error(std::string("getRectilinearFrames::getEquilinarFrames bad alloc..."));
+			return ;
 		}
-	}
-
 
-	// Run `Option::threads` threads to do all the projections.
-	boost::thread_group group;
-	for(size_t i = 0 ; i < Option::threads ; ++i) {
-		group.create_thread(boost::bind(&ProjectedSaliency::getRectilinearFramesJob, this, boost::ref(inputImage)));
+		frame.nrAzim 	= centres[i].first;
+		frame.nrElev 	= centres[i].second;
+		frame.nrApper 	= aperture;
+		frame.nrFeather = feather;
 	}
-	group.join_all();
 
 
-	// reset all task flags, to be ready for the next task
+	m_Frames.clear();
 	for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-		it->taskDone = false;
+		m_Frames.push_back(&(*it));
 	}
 
-}
-
+	// Run the projections on the pool, with `Option::threads` participants.
+	ThreadPool::global().parallelFor(static_cast<int>(m_Frames.size()), boost::bind(&ProjectedSaliency::getRectilinearFramesJob, this, boost::cref(inputImage), _1), static_cast<int>(Option::threads));
 
+}
 
-void ProjectedSaliency::getRectilinearFramesJob(const cv::Mat &inputImage) {
-
-	bool taskFound = true;
-
-	while(taskFound) {
-		taskFound = false;
-		ProjectedFrame *projectedFrame = NULL;
-		m_mutex.lock();
-		int taskId = 0;
-		for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-			if(!it->taskDone) {
-				taskFound = true;
-				projectedFrame = &(*it);
-
-				it->taskDone = true;		// marked the currently processed frame as estimated
-				break;
-			}
-			++taskId;
-		}
 
-		m_mutex.unlock();
 
+void ProjectedSaliency::getRectilinearFramesJob(const cv::Mat &inputImage, int task) {
+	ProjectedFrame *projectedFrame = m_Frames[task];
 
-		// if there is still something to do, do the job
-		if(taskFound) {
-			m_Projection->equirectangularToRectilinear(inputImage, projectedFrame->rectilinearFrame, static_cast<float>(projectedFrame->nrAzim), static_cast<float>(projectedFrame->nrElev));
-		}
-	}
+	m_Projection->equirectangularToRectilinear(inputImage, projectedFrame->rectilinearFrame, static_cast<float>(projectedFrame->nrAzim), static_cast<float>(projectedFrame->nrElev), 0.f, static_cast<float>(projectedFrame->nrApper));
 }
 
 
@@ -208,44 +177,17 @@ void ProjectedSaliency::getRectilinearSaliency() {
 	}
 
 
-	boost::thread_group group;
-	for(int i = 0 ; i < static_cast<int>(m_SaliencyWorkers.size()) ; ++i) {
-		group.create_thread(boost::bind(&ProjectedSaliency::getRectilinearSaliencyJob, this, i));
-	}
-	group.join_all();	
+	// one participant per worker: the slot of the participant gives its worker
+	ThreadPool::global().parallelFor(static_cast<int>(m_Frames.size()), boost::bind(&ProjectedSaliency::getRectilinearSaliencyJob, this, _1, _2), static_cast<int>(m_SaliencyWorkers.size()));
 }
 
 
 
-void ProjectedSaliency::getRectilinearSaliencyJob(int workerID) {
+void ProjectedSaliency::getRectilinearSaliencyJob(int task, int workerID) {
 	boost::shared_ptr<Saliency> &saliency = m_SaliencyWorkers[workerID];
+	ProjectedFrame *projectedFrame = m_Frames[task];
 
-	// look for a frame which need to be processed
-	bool taskFound = true;
-
-	while(taskFound) {
-		taskFound = false;
-		ProjectedFrame *projectedFrame = NULL;
-		m_mutex.lock();
-		for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-			if(!it->taskDone) {
-				taskFound = true;
-				projectedFrame = &(*it);
-
-				it->taskDone = true;		// marked the currently processed frame as estimated
-				break;
-			}
-		}
-
-		m_mutex.unlock();
-
-
-		// if there is still something to do, do the job
-		if(taskFound) {
-			saliency->estimate(projectedFrame->rectilinearFrame, projectedFrame->saliency, false);
-		}
-
-	}
+	saliency->estimate(projectedFrame->rectilinearFrame, projectedFrame->saliency, false);
 }
 
 
@@ -279,51 +221,40 @@ void ProjectedSaliency::getEquirectangularSaliency() {
 	int rows = 4 * (static_cast<int>(m_Projection->nreHeight*scaling) / 4); // 0
 	int cols = 4 * (static_cast<int>(m_Projection->nreWidth*scaling) / 4); // 1
 
-	m_EquirectangularSaliency = cv::Mat(rows, cols, CV_32FC3, cv::Scalar(0.f,0.f,0.f));
-	cv::Mat count(rows, cols, CV_32FC1, cv::Scalar(0.f));
+	// the saliency maps are gathered through the remap table of their frame (see RemapTable)
+	cv::Mat sum(rows, cols, CV_64FC1, cv::Scalar(0));
+	cv::Mat weights(rows, cols, CV_64FC1, cv::Scalar(0));
 
 	for(std::list<ProjectedFrame>::iterator it = m_ProjectedFrames.begin() ; it != m_ProjectedFrames.end() ; ++it) {
-		cv::Mat tmp(rows, cols, CV_32FC3, cv::Scalar(0,0,0));
-
-		m_Projection->nrAzim = it->nrAzim;
-		m_Projection->nrElev = it->nrElev;
-
-		cv::Mat toProjSailMap(it->saliency.rows, it->saliency.cols, CV_32FC3, cv::Scalar(0.f,0.f,0.f));
-		for(int i = 0 ; i < toProjSailMap.rows ; ++i) {
-			for(int j = 0 ; j < toProjSailMap.cols ; ++j) {
-				cv::Point3_<float> &dst = toProjSailMap.at< cv::Point3_<float> >(i,j);
-				dst.x = it->saliency.at<float>(i,j);
-				dst.y = 1;
-			}
-		}
-
-
-		m_Projection->rectilinearToEquirectangularFC3(toProjSailMap, tmp);
-
-		for(int i = 0 ; i < m_EquirectangularSaliency.rows ; ++i) {
-			for(int j = 0 ; j < m_EquirectangularSaliency.cols ; ++j) {
-				cv::Point3_<float> &col = tmp.at< cv::Point3_<float> >(i,j);
-				cv::Point3_<float> &dst = m_EquirectangularSaliency.at< cv::Point3_<float> >(i,j);
-				
-				if(col.y < 0.999) continue;
-
-				++count.at<float>(i,j);
-				dst.x += col.x;
-			}
-		}
+		cv::Mat saliency;
+		it->saliency.convertTo(saliency, CV_64FC1);
+
+		RemapTable::Geometry geometry;
+		geometry.tileWidth 	= saliency.cols;
+		geometry.tileHeight = saliency.rows;
+		geometry.width 		= cols;
+		geometry.height 	= rows;
+		geometry.azim 		= static_cast<float>(it->nrAzim);
+		geometry.elev 		= static_cast<float>(it->nrElev);
+		geometry.roll 		= 0.f;
+		geometry.aperture 	= static_cast<float>(it->nrApper);
+		geometry.feather 	= static_cast<float>(it->nrFeather);
+		geometry.sphere 	= 0;
+
+		RemapTable::get(geometry)->accumulate(saliency, sum, weights);
 	}
 
 
-
+	m_EquirectangularSaliency = cv::Mat(rows, cols, CV_32FC3, cv::Scalar(0.f,0.f,0.f));
 	for(int i = 0 ; i < m_EquirectangularSaliency.rows ; ++i) {
 		for(int j = 0 ; j < m_EquirectangularSaliency.cols ; ++j) {
 			cv::Point3_<float> &dst = m_EquirectangularSaliency.at< cv::Point3_<float> >(i,j);
 
-			float c = count.at<float>(i,j);
+			double w = weights.at<double>(i,j);
 
-			if(c < 1) continue;
+			if(w <= 0) continue;
 
-			dst.x /= c;
+			dst.x = static_cast<float>(sum.at<double>(i,j) / w);
 		}
 	}
 }
@@ -29,7 +29,6 @@
 
 #include "Saliency.h"
 #include <boost/shared_ptr.hpp>
-#include <boost/thread/mutex.hpp>
 #include <vector>
 #include <list>
 
@@ -50,8 +49,8 @@ private:
 	boost::shared_ptr<Saliency>							m_Saliency;
 
 	std::list<ProjectedFrame> 							m_ProjectedFrames;
+	std::vector<ProjectedFrame*> 						m_Frames;			// the frames, by task index
 	std::vector< boost::shared_ptr<Saliency> > 			m_SaliencyWorkers;
-	boost::mutex										m_mutex;
 	cv::Mat												m_EquirectangularSaliency;
 
 
@@ -85,13 +84,13 @@ private:
 
 
 	void 			getRectilinearFrames	(const cv::Mat &inputImage);
-	void			getRectilinearFramesJob	(const cv::Mat &inputImage);
+	void			getRectilinearFramesJob	(const cv::Mat &inputImage, int task);
 
 
 
 	// baselines 1 & 2
 	void 			getRectilinearSaliency	  ();
-	void			getRectilinearSaliencyJob (int workerID);
+	void			getRectilinearSaliencyJob (int task, int workerID);
 	void 			getEquirectangularSaliency();
 	void 			getActivation 			  (cv::Mat &output);
 
@@ -32,6 +32,7 @@
 
 #include "Options.h"
 #include <gnomonic-all.h>
+#include <ThreadPool.h>
 #include "common-method.h"
 
 Projection::Projection() {
@@ -72,6 +73,8 @@ Projection::Projection() {
 }
 
 void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat& nroImage) {
+	ThreadPool::Share threads(nrThread);
+
 	
 	if(nroImage.cols == 0 || nroImage.rows == 0) {
 		throw std::logic_error(std::string("Projection::equirectangularToRectilinear : The output image was not allocated. Maybe you did not provided the size of the output image. Cannot continue.")); 
@@ -101,7 +104,7 @@ void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat
                 nrFocal,
                 nrPixel,
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
             );
             break;
 
@@ -128,7 +131,7 @@ void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat
                 nrPixel,
                 nrFocal,
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
         break;
@@ -153,7 +156,7 @@ void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat
                 nrFocal,
                 nrPixel,
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
         break;
@@ -174,7 +177,7 @@ void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat
                 nrRoll  * ( LG_PI / 180.0 ),
                 nrApper * ( LG_PI / 180.0 ),
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
          break;
@@ -183,7 +186,11 @@ void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat
 
 }
 
-void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat& output, float azim, float elev, float roll) {
+void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat& output, float azim, float elev, float roll, float apper) {
+	ThreadPool::Share threads(nrThread);
+
+	if(apper <= 0.f) apper = static_cast<float>(nrApper);
+
 
     lg_etg_apperturep( 
         ( inter_C8_t * ) inputImage.data,
@@ -197,9 +204,9 @@ void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat
         azim    * ( LG_PI / 180.0 ),
         elev    * ( LG_PI / 180.0 ),
         roll    * ( LG_PI / 180.0 ),
-        nrApper * ( LG_PI / 180.0 ),
+        apper   * ( LG_PI / 180.0 ),
         lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-        nrThread
+        threads.size()
 
     );
 }
@@ -207,6 +214,8 @@ void Projection::equirectangularToRectilinear(const cv::Mat& inputImage, cv::Mat
 
 
 void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat& output) {
+	ThreadPool::Share threads(nrThread);
+
     if(output.cols == 0 || output.rows == 0) {
         throw std::logic_error(std::string("Projection::rectilinearToEquirectangular : The output image was not allocated. Maybe you did not provided the size of the output image. Cannot continue.")); 
         return;
@@ -235,7 +244,7 @@ void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat
                 nrFocal,
                 nrPixel,
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
             );
             break;
 
@@ -262,7 +271,7 @@ void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat
                 nrPixel,
                 nrFocal,
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
         break;
@@ -287,7 +296,7 @@ void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat
                 nrFocal,
                 nrPixel,
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
         break;
@@ -308,7 +317,7 @@ void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat
                 nrRoll  * ( LG_PI / 180.0 ),
                 nrApper * ( LG_PI / 180.0 ),
                 lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
          break;
@@ -318,6 +327,8 @@ void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat
 
 
 void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat& output, float azim, float elev, float roll) {
+	ThreadPool::Share threads(nrThread);
+
     lg_gte_apperturep( 
         ( inter_C8_t * ) output.data,
         output.cols,
@@ -332,7 +343,7 @@ void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat
         roll  * ( LG_PI / 180.0 ),
         nrApper * ( LG_PI / 180.0 ),
         lc_method( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-        nrThread
+        threads.size()
 
     );
 }
@@ -340,6 +351,8 @@ void Projection::rectilinearToEquirectangular(const cv::Mat& inputImage, cv::Mat
 
 
 void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::Mat& output) {
+	ThreadPool::Share threads(nrThread);
+
     if(output.cols == 0 || output.rows == 0) {
         throw std::logic_error(std::string("Projection::rectilinearToEquirectangular : The output image was not allocated. Maybe you did not provided the size of the output image. Cannot continue.")); 
         return;
@@ -369,7 +382,7 @@ void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::
                 nrFocal,
                 nrPixel,
                 lc_method_f( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
             );
             break;
 
@@ -396,7 +409,7 @@ void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::
                 nrPixel,
                 nrFocal,
                 lc_method_f( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
         break;
@@ -421,7 +434,7 @@ void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::
                 nrFocal,
                 nrPixel,
                 lc_method_f( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
         break;
@@ -442,7 +455,7 @@ void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::
                 nrRoll  * ( LG_PI / 180.0 ),
                 nrApper * ( LG_PI / 180.0 ),
                 lc_method_f( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-                nrThread
+                threads.size()
 
             );
          break;
@@ -453,6 +466,8 @@ void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::
 }
 
 void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::Mat& output, float azim, float elev, float roll) {
+	ThreadPool::Share threads(nrThread);
+
     lg_gte_apperturep_f( 
         ( float * ) output.data,
         output.cols,
@@ -467,7 +482,7 @@ void Projection::rectilinearToEquirectangularFC3(const cv::Mat& inputImage, cv::
         roll  * ( LG_PI / 180.0 ),
         nrApper * ( LG_PI / 180.0 ),
         lc_method_f( nrMethod.empty() ? "bicubicf" : nrMethod.c_str() ),
-        nrThread
+        threads.size()
     );
 }
 
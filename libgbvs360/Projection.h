@@ -76,7 +76,7 @@ public:
 	Projection();
 	
 	void equirectangularToRectilinear(const cv::Mat& input, cv::Mat& output);
-	void equirectangularToRectilinear(const cv::Mat& input, cv::Mat& output, float azim, float elev, float roll = 0.f);
+	void equirectangularToRectilinear(const cv::Mat& input, cv::Mat& output, float azim, float elev, float roll = 0.f, float apper = 0.f);	// apper: 0 for nrApper
 
 	void rectilinearToEquirectangular(const cv::Mat& input, cv::Mat& output);
 	void rectilinearToEquirectangular(const cv::Mat& input, cv::Mat& output, float azim, float elev, float roll = 0.f);
@@ -0,0 +1,238 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#include "RemapTable.h"
+#include "SphereGraph.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <gnomonic-all.h>
+
+
+boost::mutex 												RemapTable::s_Mutex;
+std::map<RemapTable::Geometry, boost::shared_ptr<const RemapTable> > RemapTable::s_Tables;
+
+
+
+bool RemapTable::Geometry::operator< (const Geometry &g) const {
+	if(tileWidth  != g.tileWidth)  return tileWidth  < g.tileWidth;
+	if(tileHeight != g.tileHeight) return tileHeight < g.tileHeight;
+	if(width      != g.width)      return width      < g.width;
+	if(height     != g.height)     return height     < g.height;
+	if(azim       != g.azim)       return azim       < g.azim;
+	if(elev       != g.elev)       return elev       < g.elev;
+	if(roll       != g.roll)       return roll       < g.roll;
+	if(aperture   != g.aperture)   return aperture   < g.aperture;
+	if(feather    != g.feather)    return feather    < g.feather;
+	return sphere < g.sphere;
+}
+
+
+
+// weights of the cubic through the nodes 0, 1, 2, 3 (see li_bicubicf_f), at t in [1, 2)
+static void cubicWeights(double t, double *w) {
+	w[0] = -(t-1) * (t-2) * (t-3) / 6;
+	w[1] =  t     * (t-2) * (t-3) / 2;
+	w[2] = -t     * (t-1) * (t-3) / 2;
+	w[3] =  t     * (t-1) * (t-2) / 6;
+}
+
+
+// the 4 nodes around x, clamped to the image as in li_bicubicf_f
+static void cubicNodes(int reference, int size, int *nodes) {
+	for(int k = 0 ; k < 4 ; ++k) {
+		nodes[k] = std::min(size-1, std::max(0, reference - 1 + k));
+	}
+}
+
+
+
+// same mapping as lg_gtt_genericp_f, with the parameters of lg_gte_apperturep_f. The targets are the 
+// pixels of the equirectangular image, or the nodes of the sphere grid.
+RemapTable::RemapTable(const Geometry &geometry) : m_Geometry(geometry) {
+
+	boost::shared_ptr<const SphereGraph> sphere;
+	if(geometry.sphere > 0) {
+		sphere = SphereGraph::get(geometry.sphere);
+		if(geometry.width != 1 || geometry.height != sphere->size()) {
+			throw std::logic_error(std::string("RemapTable::RemapTable(): the map does not match the sphere grid."));
+		}
+	} else if(geometry.width <= 1 || geometry.height <= 1) {
+		throw std::logic_error(std::string("RemapTable::RemapTable(): invalid geometry."));
+	}
+
+	if(geometry.tileWidth <= 0 || geometry.tileHeight <= 0 || geometry.feather < 0) {
+		throw std::logic_error(std::string("RemapTable::RemapTable(): invalid geometry."));
+	}
+
+	lg_algebra_e2rrotation(m_Rotation, geometry.azim * ( LG_PI / 180.0 ), geometry.elev * ( LG_PI / 180.0 ), geometry.roll * ( LG_PI / 180.0 ));
+	m_Pixel = 2.0 * std::tan(geometry.aperture * ( LG_PI / 180.0 ) / 2.0) / geometry.tileWidth;
+
+	if(sphere) {
+		for(int n = 0 ; n < sphere->size() ; ++n) {
+			addTarget(n, sphere->node(n));
+		}
+		return;
+	}
+
+	double edgeX  = geometry.width  - 1;
+	double edgeY  = geometry.height - 1;
+
+	for(int dy = 0 ; dy < geometry.height ; ++dy) {
+		for(int dx = 0 ; dx < geometry.width ; ++dx) {
+			double sx = ( static_cast<double>(dx) / edgeX ) * LG_PI2;
+			double sy = ( ( static_cast<double>(dy) / edgeY ) - 0.5 ) * LG_PI;
+
+			double pvi[3];
+			pvi[0] = std::cos(sy);
+			pvi[1] = pvi[0] * std::sin(sx);
+			pvi[0] = pvi[0] * std::cos(sx);
+			pvi[2] = std::sin(sy);
+
+			addTarget(dy * geometry.width + dx, pvi);
+		}
+	}
+}
+
+
+
+// adds the target if its direction pvi falls in the tile
+void RemapTable::addTarget(int index, const double *pvi) {
+	double pvf0 = m_Rotation[0][0] * pvi[0] + m_Rotation[0][1] * pvi[1] + m_Rotation[0][2] * pvi[2];
+	if(pvf0 <= 0) return;
+
+	double pvf1 = m_Rotation[1][0] * pvi[0] + m_Rotation[1][1] * pvi[1] + m_Rotation[1][2] * pvi[2];
+	double pvf2 = m_Rotation[2][0] * pvi[0] + m_Rotation[2][1] * pvi[1] + m_Rotation[2][2] * pvi[2];
+
+	double sightX = static_cast<double>(m_Geometry.tileWidth)  / 2.0;
+	double sightY = static_cast<double>(m_Geometry.tileHeight) / 2.0;
+
+	double x = ( pvf1 / pvf0 ) / m_Pixel + sightX;
+	double y = ( pvf2 / pvf0 ) / m_Pixel + sightY;
+
+	if(!(x >= 0 && y >= 0 && x < m_Geometry.tileWidth && y < m_Geometry.tileHeight)) return;
+
+	int columns[4], rows[4];
+	double wx[4], wy[4];
+	double fx = std::floor(x);
+	double fy = std::floor(y);
+	cubicNodes(static_cast<int>(fx), m_Geometry.tileWidth,  columns);
+	cubicNodes(static_cast<int>(fy), m_Geometry.tileHeight, rows);
+	cubicWeights(x + 1.0 - fx, wx);
+	cubicWeights(y + 1.0 - fy, wy);
+
+	m_Index.push_back(index);
+	m_Columns.insert(m_Columns.end(), columns, columns+4);
+	m_Rows.insert(m_Rows.end(), rows, rows+4);
+	m_WeightX.insert(m_WeightX.end(), wx, wx+4);
+	m_WeightY.insert(m_WeightY.end(), wy, wy+4);
+
+	if(m_Geometry.feather > 0) {
+		// distance to the border of the tile in its tangent plane
+		double border = std::min(m_Pixel * sightX - std::abs(pvf1 / pvf0), m_Pixel * sightY - std::abs(pvf2 / pvf0));
+		m_Feather.push_back(std::max(0.0, std::min(1.0, border / m_Geometry.feather)));
+	}
+}
+
+
+
+boost::shared_ptr<const RemapTable> RemapTable::get(const Geometry &geometry) {
+	{
+		boost::mutex::scoped_lock lock(s_Mutex);
+		std::map<Geometry, boost::shared_ptr<const RemapTable> >::const_iterator it = s_Tables.find(geometry);
+		if(it != s_Tables.end())
+			return it->second;
+	}
+
+	// built without the lock: the tables of the different frames are built in parallel. If two threads 
+	// build the same table, the first one inserted is kept.
+	boost::shared_ptr<const RemapTable> table(new RemapTable(geometry));
+
+	boost::mutex::scoped_lock lock(s_Mutex);
+	return s_Tables.insert(std::make_pair(geometry, table)).first->second;
+}
+
+
+
+void RemapTable::accumulate(const cv::Mat &tile, cv::Mat &map, cv::Mat &weights) const {
+	if(tile.depth() != CV_64F || tile.cols != m_Geometry.tileWidth || tile.rows != m_Geometry.tileHeight
+	|| map.type() != tile.type() || map.cols != m_Geometry.width || map.rows != m_Geometry.height || !map.isContinuous()
+	|| weights.type() != CV_64FC1 || weights.size() != map.size() || !weights.isContinuous()) {
+		throw std::logic_error(std::string("RemapTable::accumulate(): the maps do not match the geometry of the table."));
+	}
+
+	const int 	 nbChannels = tile.channels();
+	const bool 	 feather 	= !m_Feather.empty();
+	double 		*dst 	  	= map.ptr<double>(0);
+	double 		*sums 	  	= weights.ptr<double>(0);
+
+	if(nbChannels == 1) {
+		for(size_t i = 0 ; i < m_Index.size() ; ++i) {
+			const int 	 *columns = &m_Columns[4*i];
+			const int 	 *rows 	  = &m_Rows[4*i];
+			const double *wx 	  = &m_WeightX[4*i];
+			const double *wy 	  = &m_WeightY[4*i];
+
+			double v = 0;
+			for(int r = 0 ; r < 4 ; ++r) {
+				const double *src = tile.ptr<double>(rows[r]);
+				v += wy[r] * (wx[0] * src[columns[0]] + wx[1] * src[columns[1]] + wx[2] * src[columns[2]] + wx[3] * src[columns[3]]);
+			}
+
+			if(feather) {
+				dst[m_Index[i]]  += m_Feather[i] * v;
+				sums[m_Index[i]] += m_Feather[i];
+			} else {
+				dst[m_Index[i]]  += v;
+				sums[m_Index[i]] += 1;
+			}
+		}
+		return;
+	}
+
+	// packed maps: the channels of a tap are contiguous, the stencil is read once for all of them
+	for(size_t i = 0 ; i < m_Index.size() ; ++i) {
+		const int 	 *columns = &m_Columns[4*i];
+		const int 	 *rows 	  = &m_Rows[4*i];
+		const double *wx 	  = &m_WeightX[4*i];
+		const double *wy 	  = &m_WeightY[4*i];
+		const double  weight  = feather ? m_Feather[i] : 1.0;
+		double 		 *out 	  = dst + static_cast<size_t>(m_Index[i]) * nbChannels;
+
+		for(int r = 0 ; r < 4 ; ++r) {
+			const double *src = tile.ptr<double>(rows[r]);
+			for(int c = 0 ; c < 4 ; ++c) {
+				const double  w   = weight * wy[r] * wx[c];
+				const double *tap = src + columns[c] * nbChannels;
+				for(int k = 0 ; k < nbChannels ; ++k) {
+					out[k] += w * tap[k];
+				}
+			}
+		}
+
+		sums[m_Index[i]] += weight;
+	}
+}
@@ -0,0 +1,111 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _RemapTable_
+#define _RemapTable_
+
+#include <map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+// Back-projection of a rectilinear tile to the equirectangular domain, with the geometry of 
+// Projection::rectilinearToEquirectangularFC3 (gnomonic projection defined by its aperture, bicubic 
+// interpolation).
+//
+// The geometry only depends on the orientation of the tile, the aperture and the sizes of the two 
+// images. The table keeps the equirectangular pixels covered by the tile, with the bicubic stencil of 
+// each one in the tile (4 columns, 4 rows and their weights). All the maps of a frame are then 
+// back-projected by gathering, without the spherical trigonometry and without visiting the pixels 
+// which are not covered. Tables are shared by geometry through RemapTable::get().
+//
+// With a feather band, the contribution of a pixel fades out linearly over the band (in the tangent 
+// plane of the tile) towards the borders of the tile. Overlapping tiles, such as the faces of a cube 
+// map with a guard band, are then blended across their seams instead of averaged.
+//
+// The targets can also be the nodes of a SphereGraph, stored as a map of N x 1.
+
+class RemapTable {
+
+public:
+
+	struct Geometry {
+		int 	tileWidth;
+		int 	tileHeight;
+		int 	width;			// equirectangular image
+		int 	height;
+		float 	azim;			// degrees
+		float 	elev;
+		float 	roll;
+		float 	aperture;
+		float 	feather;		// width of the band in the tangent plane, 0 for uniform weights
+		int 	sphere;			// > 0: the targets are the nodes of the SphereGraph with this number of 
+								// subdivisions (width = 1, height = nodes) instead of the equirectangular pixels
+
+		bool operator< (const Geometry &g) const;
+	};
+
+
+	explicit 					RemapTable 		(const Geometry &geometry);
+
+	// table of the geometry, built on the first request and then kept for the process
+	static boost::shared_ptr<const RemapTable> 	get (const Geometry &geometry);
+
+
+	const Geometry& 			geometry 		() const 		{ return m_Geometry; }
+	size_t 						size 			() const 		{ return m_Index.size(); }
+
+	// adds the interpolated tile (CV_64FC(n), tileWidth x tileHeight) to the covered pixels of map 
+	// (same type, width x height), and sums the weights of the contributions in weights (CV_64FC1). 
+	// With n > 1, the channels are packed feature maps sharing the coverage.
+	void 						accumulate 		(const cv::Mat &tile, cv::Mat &map, cv::Mat &weights) const;
+
+
+private:
+
+	void 						addTarget 		(int index, const double *direction);
+
+
+	Geometry 					m_Geometry;
+	double 						m_Rotation[3][3];	// equirectangular to tile frame
+	double 						m_Pixel;			// size of a tile pixel in the tangent plane
+
+	std::vector<int> 			m_Index;		// covered pixel of the equirectangular image
+	std::vector<int> 			m_Columns;		// 4 per pixel
+	std::vector<int> 			m_Rows;			// 4 per pixel
+	std::vector<double> 		m_WeightX;		// 4 per pixel
+	std::vector<double> 		m_WeightY;		// 4 per pixel
+	std::vector<double> 		m_Feather;		// 1 per pixel, empty without feather band
+
+
+	static boost::mutex 										s_Mutex;
+	static std::map<Geometry, boost::shared_ptr<const RemapTable> > s_Tables;
+};
+
+
+#endif
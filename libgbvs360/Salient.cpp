@@ -30,6 +30,8 @@
 #include "GBVSSaliency.h"
 #include "Saliency360.h"
 
+#include <ThreadPool.h>
+
 
 // ---------------------------------------------------------------------------------------------------------------------------------------
 // Forward declaration
@@ -59,6 +61,7 @@ void computeHS(const unsigned char *imgRGB, int cols, int rows, float *saliency,
     pointerToCVMat(imgRGB, cols, rows, input);
 
     Option::threads = nbThreads;
+    ThreadPool::global().resize(nbThreads - 1);
 
     cv::Mat salmap;
     Saliency360 saliency360;
@@ -87,6 +90,7 @@ void computeHES(const unsigned char *imgRGB, int cols, int rows, float *saliency
     pointerToCVMat(imgRGB, cols, rows, input);
 
     Option::threads = nbThreads;
+    ThreadPool::global().resize(nbThreads - 1);
 
     cv::Mat salmap;
     Saliency360 saliency360;
@@ -118,6 +122,7 @@ void computeScanPath    (const unsigned char *imgRGB, int cols, int rows, float
     pointerToCVMat(imgRGB, cols, rows, input);
 
     Option::threads = nbThreads;
+    ThreadPool::global().resize(nbThreads - 1);
     Option::experimentRepppetition = n;
 
 
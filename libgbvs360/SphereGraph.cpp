@@ -0,0 +1,373 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#include "SphereGraph.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <GBVS.h>
+
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+boost::mutex 											SphereGraph::s_Mutex;
+std::map<int, boost::shared_ptr<const SphereGraph> > 	SphereGraph::s_Graphs;
+
+
+
+static inline double dot(const double *a, const double *b) {
+	return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+// p . (a x b)
+static inline double triple(const double *p, const double *a, const double *b) {
+	return p[0] * (a[1]*b[2] - a[2]*b[1]) + p[1] * (a[2]*b[0] - a[0]*b[2]) + p[2] * (a[0]*b[1] - a[1]*b[0]);
+}
+
+// direction of the pixel (i, j) of an equirectangular image, same convention as the projection (see RemapTable)
+static inline void pixelDirection(int i, int j, int rows, int cols, double *p) {
+	double sx = ( static_cast<double>(j) / (cols - 1) ) * 2 * M_PI;
+	double sy = ( ( static_cast<double>(i) / (rows - 1) ) - 0.5 ) * M_PI;
+	p[0] = std::cos(sy) * std::cos(sx);
+	p[1] = std::cos(sy) * std::sin(sx);
+	p[2] = std::sin(sy);
+}
+
+
+
+// ----------------------------------------------------------------------------------------------------------
+// mesh
+
+
+SphereGraph::SphereGraph(int subdivisions) : m_Subdivisions(subdivisions) {
+	if(subdivisions < 0 || subdivisions > maxSubdivisions) {
+		throw std::logic_error(std::string("SphereGraph::SphereGraph(): the number of subdivisions must be in [0, 7]."));
+	}
+
+	// icosahedron, faces oriented outwards
+	const double t = (1.0 + std::sqrt(5.0)) / 2.0;
+	const double vertices[12][3] = {
+		{-1,  t,  0}, { 1,  t,  0}, {-1, -t,  0}, { 1, -t,  0},
+		{ 0, -1,  t}, { 0,  1,  t}, { 0, -1, -t}, { 0,  1, -t},
+		{ t,  0, -1}, { t,  0,  1}, {-t,  0, -1}, {-t,  0,  1}
+	};
+	const int faces[20][3] = {
+		{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+		{1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+		{3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+		{4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
+	};
+
+	for(int i = 0 ; i < 12 ; ++i) {
+		double n = std::sqrt(dot(vertices[i], vertices[i]));
+		for(int k = 0 ; k < 3 ; ++k)
+			m_Nodes.push_back(vertices[i][k] / n);
+	}
+
+	m_Triangles.resize(subdivisions + 1);
+	m_Triangles[0].assign(&faces[0][0], &faces[0][0] + 60);
+
+	// each edge is split once: its middle node is shared by the two triangles of the edge
+	std::map< std::pair<int, int>, int > middles;
+	for(int level = 0 ; level < subdivisions ; ++level) {
+		const std::vector<int> &parents = m_Triangles[level];
+		std::vector<int> &children = m_Triangles[level+1];
+
+		for(size_t f = 0 ; f < parents.size() ; f += 3) {
+			int corners[3] = { parents[f], parents[f+1], parents[f+2] };
+			int mid[3];
+
+			for(int e = 0 ; e < 3 ; ++e) {
+				int a = corners[e];
+				int b = corners[(e+1) % 3];
+				std::pair<int, int> edge(std::min(a, b), std::max(a, b));
+
+				std::map< std::pair<int, int>, int >::const_iterator it = middles.find(edge);
+				if(it != middles.end()) {
+					mid[e] = it->second;
+					continue;
+				}
+
+				double m[3];
+				for(int k = 0 ; k < 3 ; ++k)
+					m[k] = m_Nodes[3*a+k] + m_Nodes[3*b+k];
+				double n = std::sqrt(dot(m, m));
+
+				mid[e] = size();
+				for(int k = 0 ; k < 3 ; ++k)
+					m_Nodes.push_back(m[k] / n);
+				middles[edge] = mid[e];
+			}
+
+			// a, ab, ca | ab, b, bc | ca, bc, c | ab, bc, ca
+			int split[12] = { corners[0], mid[0], mid[2],
+							  mid[0], corners[1], mid[1],
+							  mid[2], mid[1], corners[2],
+							  mid[0], mid[1], mid[2] };
+			children.insert(children.end(), split, split+12);
+		}
+	}
+}
+
+
+
+boost::shared_ptr<const SphereGraph> SphereGraph::get(int subdivisions) {
+	boost::mutex::scoped_lock lock(s_Mutex);
+
+	std::map<int, boost::shared_ptr<const SphereGraph> >::const_iterator it = s_Graphs.find(subdivisions);
+	if(it != s_Graphs.end())
+		return it->second;
+
+	boost::shared_ptr<const SphereGraph> graph(new SphereGraph(subdivisions));
+	s_Graphs[subdivisions] = graph;
+	return graph;
+}
+
+
+
+// ----------------------------------------------------------------------------------------------------------
+// point location
+
+
+int SphereGraph::locate(const double *p, double *weights) const {
+
+	// the subdivided triangles tile their parent: the direction is followed down the levels, in the 
+	// child where it is the furthest inside (robust on the edges)
+	int triangle = -1;
+	int first = 0;
+	int count = 20;
+	for(size_t level = 0 ; level < m_Triangles.size() ; ++level) {
+		const std::vector<int> &triangles = m_Triangles[level];
+
+		double best = -std::numeric_limits<double>::max();
+		int bestTriangle = first;
+		for(int t = first ; t < first + count ; ++t) {
+			const double *a = node(triangles[3*t]);
+			const double *b = node(triangles[3*t+1]);
+			const double *c = node(triangles[3*t+2]);
+
+			double inside = std::min(triple(p, a, b), std::min(triple(p, b, c), triple(p, c, a)));
+			if(inside > best) {
+				best = inside;
+				bestTriangle = t;
+			}
+		}
+
+		triangle = bestTriangle;
+		first = 4 * triangle;
+		count = 4;
+	}
+
+	// barycentric weights of the intersection of the direction with the plane of the triangle
+	const std::vector<int> &triangles = m_Triangles.back();
+	const double *a = node(triangles[3*triangle]);
+	const double *b = node(triangles[3*triangle+1]);
+	const double *c = node(triangles[3*triangle+2]);
+
+	weights[0] = std::max(0.0, triple(p, b, c));
+	weights[1] = std::max(0.0, triple(p, c, a));
+	weights[2] = std::max(0.0, triple(p, a, b));
+
+	double sum = weights[0] + weights[1] + weights[2];
+	if(sum <= 0) {
+		weights[0] = 1; weights[1] = weights[2] = 0;
+	} else {
+		for(int k = 0 ; k < 3 ; ++k)
+			weights[k] /= sum;
+	}
+
+	return triangle;
+}
+
+
+
+// ----------------------------------------------------------------------------------------------------------
+// graph
+
+
+void SphereGraph::buildFrame(const std::vector<int> &mapSize, double scaling, bool sparse, double maxDistance, Frame &frame) const {
+	if(!sparse && m_Subdivisions > maxDenseSubdivisions) {
+		throw std::logic_error(std::string("SphereGraph::buildFrame(): the dense graph needs no more than 5 subdivisions, use the sparse graph."));
+	}
+
+	const int N = size();
+
+	// pixels of the equirectangular map per radian, at the equator
+	const double unit = mapSize[1] / (2 * M_PI);
+
+	// one node per row of the maps
+	frame.lx = cv::Mat(N, 3, CV_64FC1, cv::Scalar(0));
+	for(int i = 0 ; i < N ; ++i) {
+		frame.lx.at<double>(i, 0) = i;
+		frame.lx.at<double>(i, 1) = 1;
+		frame.lx.at<double>(i, 2) = i;
+	}
+
+	// sigma is a fraction of the mean dimension of the equirectangular map (see graphsalapply)
+	frame.dims.assign(1, std::pair<int, int>(mapSize[0], mapSize[1]));
+	frame.multilevels.clear();
+
+	if(!sparse) {
+		frame.d = cv::Mat(N, N, CV_64FC1, cv::Scalar(0));
+
+		for(int r = 0 ; r < N ; ++r) {
+			for(int c = 0 ; c < N ; ++c) {
+				double angle = std::acos(std::max(-1.0, std::min(1.0, dot(node(r), node(c)))));
+				frame.d.at<double>(r, c) = scaling * (angle * unit) * (angle * unit);
+			}
+		}
+		return;
+	}
+
+
+	// edges of the mesh, and the longest of them
+	std::vector< std::vector<int> > neighbours(N);
+	const std::vector<int> &triangles = m_Triangles.back();
+	double longestEdge = 0;
+	for(size_t t = 0 ; t < triangles.size() ; t += 3) {
+		for(int e = 0 ; e < 3 ; ++e) {
+			int a = triangles[t+e];
+			int b = triangles[t+(e+1)%3];
+			if(std::find(neighbours[a].begin(), neighbours[a].end(), b) == neighbours[a].end()) {
+				neighbours[a].push_back(b);
+				neighbours[b].push_back(a);
+				longestEdge = std::max(longestEdge, std::acos(std::max(-1.0, std::min(1.0, dot(node(a), node(b))))));
+			}
+		}
+	}
+
+	// the walk goes through the nodes up to one edge beyond the largest angle kept, so that no node in
+	// reach is missed behind a node just out of it
+	double maxAngle = std::numeric_limits<double>::max();
+	if(scaling > 0 && maxDistance < std::numeric_limits<double>::max())
+		maxAngle = std::sqrt(std::max(0.0, maxDistance) / scaling) / unit + longestEdge;
+
+	std::vector<int> rowPtr(1, 0);
+	std::vector<int> colIdx;
+	std::vector<double> distances;
+
+	std::vector<int> visited(N, -1);
+	std::vector<int> queue;
+	std::vector< std::pair<int, double> > edges;
+
+	for(int r = 0 ; r < N ; ++r) {
+		queue.assign(1, r);
+		visited[r] = r;
+		edges.clear();
+
+		for(size_t q = 0 ; q < queue.size() ; ++q) {
+			int c = queue[q];
+			double angle = std::acos(std::max(-1.0, std::min(1.0, dot(node(r), node(c)))));
+			double d = scaling * (angle * unit) * (angle * unit);
+
+			if(d <= maxDistance)
+				edges.push_back(std::make_pair(c, d));
+
+			if(angle > maxAngle)
+				continue;
+
+			for(size_t n = 0 ; n < neighbours[c].size() ; ++n) {
+				int next = neighbours[c][n];
+				if(visited[next] != r) {
+					visited[next] = r;
+					queue.push_back(next);
+				}
+			}
+		}
+
+		// the columns of a row are stored in increasing order
+		std::sort(edges.begin(), edges.end());
+		for(size_t e = 0 ; e < edges.size() ; ++e) {
+			colIdx.push_back(edges[e].first);
+			distances.push_back(edges[e].second);
+		}
+
+		rowPtr.push_back(static_cast<int>(colIdx.size()));
+	}
+
+	frame.sparse.assign(rowPtr, colIdx, distances);
+}
+
+
+
+// ----------------------------------------------------------------------------------------------------------
+// equirectangular images
+
+
+void SphereGraph::render(const cv::Mat &nodes, cv::Mat &image) const {
+	if(nodes.type() != CV_64FC1 || nodes.rows != size() || nodes.cols != 1 || image.type() != CV_64FC1 || image.rows < 2 || image.cols < 2) {
+		throw std::logic_error(std::string("SphereGraph::render(): the maps do not match the grid."));
+	}
+
+	const std::vector<int> &triangles = m_Triangles.back();
+
+	for(int i = 0 ; i < image.rows ; ++i) {
+		for(int j = 0 ; j < image.cols ; ++j) {
+			double p[3], w[3];
+			pixelDirection(i, j, image.rows, image.cols, p);
+
+			int t = locate(p, w);
+			image.at<double>(i, j) = w[0] * nodes.at<double>(triangles[3*t], 0) 
+								   + w[1] * nodes.at<double>(triangles[3*t+1], 0) 
+								   + w[2] * nodes.at<double>(triangles[3*t+2], 0);
+		}
+	}
+}
+
+
+
+void SphereGraph::sample(const cv::Mat &image, cv::Mat &nodes) const {
+	if(image.type() != CV_64FC1 || image.rows < 2 || image.cols < 2) {
+		throw std::logic_error(std::string("SphereGraph::sample(): the image must be a CV_64FC1 map."));
+	}
+
+	nodes.create(size(), 1, CV_64FC1);
+
+	for(int n = 0 ; n < size() ; ++n) {
+		const double *p = node(n);
+
+		// inverse of pixelDirection
+		double sx = std::atan2(p[1], p[0]);
+		if(sx < 0) sx += 2 * M_PI;
+		double sy = std::asin(std::max(-1.0, std::min(1.0, p[2])));
+
+		double x = sx / (2 * M_PI) * (image.cols - 1);
+		double y = (sy / M_PI + 0.5) * (image.rows - 1);
+
+		int x0 = std::min(image.cols - 2, static_cast<int>(x));
+		int y0 = std::min(image.rows - 2, static_cast<int>(y));
+		double fx = x - x0;
+		double fy = y - y0;
+
+		nodes.at<double>(n, 0) = (1-fy) * ((1-fx) * image.at<double>(y0,   x0) + fx * image.at<double>(y0,   x0+1))
+							   +    fy  * ((1-fx) * image.at<double>(y0+1, x0) + fx * image.at<double>(y0+1, x0+1));
+	}
+}
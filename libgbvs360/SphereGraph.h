@@ -0,0 +1,99 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _SphereGraph_
+#define _SphereGraph_
+
+#include <map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+struct Frame;
+
+
+// Near-uniform grid of the sphere: the vertices of a subdivided icosahedron (10 * 4^s + 2 nodes for s 
+// subdivisions). It is used as the graph of the GBVS activation instead of the equirectangular grid,
+// which oversamples the poles.
+//
+// The maps on the grid are stored as N x 1 matrices (node i in row i), so that they go through the 
+// activation like the image maps: the frame built by buildFrame() has one node per row of the map,
+// without multilevels. The features are gathered on the nodes from the rectilinear frames (see 
+// RemapTable), and the result is rendered on an equirectangular image once, at the end.
+
+class SphereGraph {
+
+public:
+
+	// the dense frame of the activation is a N x N matrix: 5 subdivisions (10242 nodes) already need
+	// about 840 MB, the next level would need 13 GB. The sparse frame only stores the close nodes.
+	static const int 	maxSubdivisions = 7;
+	static const int 	maxDenseSubdivisions = 5;
+
+	explicit 			SphereGraph 	(int subdivisions);
+
+	// grid with this number of subdivisions, built on the first request and then kept for the process
+	static boost::shared_ptr<const SphereGraph> get (int subdivisions);
+
+
+	int 				subdivisions 	() const 				{ return m_Subdivisions; }
+	int 				size 			() const 				{ return static_cast<int>(m_Nodes.size() / 3); }
+	const double* 		node 			(int i) const 			{ return &m_Nodes[3*i]; }
+
+
+	// graph of the activation. The distances are the squared geodesic distances, in pixels of the 
+	// equirectangular map mapSize (rows, cols) multiplied by scaling, so that the sigmas of GBVS keep 
+	// their meaning. Only the edges shorter than maxDistance are kept when sparse is set: they are found
+	// by walking the edges of the mesh from each node. The dense frame needs no more than 
+	// maxDenseSubdivisions.
+	void 				buildFrame 		(const std::vector<int> &mapSize, double scaling, bool sparse, double maxDistance, Frame &frame) const;
+
+	// values of the nodes (N x 1, CV_64FC1) interpolated on the triangles of the mesh, for each pixel of 
+	// the equirectangular image (CV_64FC1, allocated by the caller)
+	void 				render 			(const cv::Mat &nodes, cv::Mat &image) const;
+
+	// values of the equirectangular image (CV_64FC1) at the nodes, bilinear interpolation
+	void 				sample 			(const cv::Mat &image, cv::Mat &nodes) const;
+
+
+private:
+
+	// triangle of the finest level containing the direction p, and the weights of its 3 vertices
+	int 				locate 			(const double *p, double *weights) const;
+
+
+	int 									m_Subdivisions;
+	std::vector<double> 					m_Nodes;			// 3 per node, unit vectors
+	std::vector< std::vector<int> > 		m_Triangles;		// by level, 3 nodes per triangle. The children of 
+																// triangle t are the triangles 4t ... 4t+3 of the next level.
+
+	static boost::mutex 											s_Mutex;
+	static std::map<int, boost::shared_ptr<const SphereGraph> > 	s_Graphs;
+};
+
+
+#endif
@@ -0,0 +1,225 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#include "TilePlanner.h"
+#include "Projection.h"
+#include "Options.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <iostream>
+
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+boost::mutex 											TilePlanner::s_Mutex;
+std::map< TilePlanner::Key, std::vector<TilePlanner::Centre> > TilePlanner::s_Plans;
+
+
+
+void TilePlanner::grid(double aperture, std::vector<Centre> &centres) {
+	float scaling_x = 2;
+	float scaling_y = 1;
+
+	int nb_projections_w = static_cast<int>(std::ceil(360.f / static_cast<float>(aperture/scaling_x)));
+	int nb_projections_h = static_cast<int>(std::ceil(180.f / static_cast<float>(aperture/scaling_y)));
+
+	centres.clear();
+	for(int j = -nb_projections_h / 2 ; j <= nb_projections_h/2 ; ++j) {
+		for(int i = 0 ; i < nb_projections_w ; ++i) {
+			centres.push_back(Centre(static_cast<int>(i * aperture/scaling_x), static_cast<int>(j * aperture/scaling_y)));
+		}
+	}
+}
+
+
+// ----------------------------------------------------------------------------------------------------------
+// spiral tiling
+
+
+// n points of the spiral, as (azimuth, elevation) in degrees. The direction of a frame centred on (a, e) 
+// is (cos a cos e, sin a cos e, -sin e), see lg_algebra_e2rrotation.
+static void spiralCentres(int n, std::vector<TilePlanner::Centre> &centres) {
+	const double goldenAngle = M_PI * (3.0 - std::sqrt(5.0));
+
+	centres.clear();
+	for(int i = 0 ; i < n ; ++i) {
+		double z = (n == 1) ? 1.0 : 1.0 - 2.0 * i / (n - 1);
+		double lon = std::fmod(i * goldenAngle, 2 * M_PI);
+
+		int azim = static_cast<int>(std::floor(lon * 180.0 / M_PI + 0.5)) % 360;
+		int elev = static_cast<int>(std::floor(-std::asin(z) * 180.0 / M_PI + 0.5));
+		centres.push_back(TilePlanner::Centre(azim, elev));
+	}
+}
+
+
+// true if each direction of the probe set falls in the central part (half tangents tx, ty) of a frame, at
+// least margin radians away from its edges. The edges of the central part are great circles: the angular
+// distance of a direction to an edge is the arcsine of its distance to the plane of the great circle.
+static bool covers(const std::vector<TilePlanner::Centre> &centres, const std::vector<double> &probes, double tx, double ty, double margin) {
+	const double sinMargin = std::sin(margin);
+	const double nx = std::sqrt(1.0 + tx*tx);
+	const double ny = std::sqrt(1.0 + ty*ty);
+
+	std::vector<double> axes(9 * centres.size());
+	for(size_t k = 0 ; k < centres.size() ; ++k) {
+		double a  = centres[k].first  * M_PI / 180.0;
+		double e  = centres[k].second * M_PI / 180.0;
+		double *m = &axes[9*k];
+
+		// rows of lg_algebra_e2rrotation, without roll
+		m[0] = std::cos(a) * std::cos(e);	m[1] = std::sin(a) * std::cos(e);	m[2] = -std::sin(e);
+		m[3] = -std::sin(a);				m[4] = std::cos(a);					m[5] = 0;
+		m[6] = std::cos(a) * std::sin(e);	m[7] = std::sin(a) * std::sin(e);	m[8] = std::cos(e);
+	}
+
+	size_t last = 0;		// the frame which covered the previous probe is tried first
+	for(size_t i = 0 ; i < probes.size() ; i += 3) {
+		const double *p = &probes[i];
+
+		bool covered = false;
+		for(size_t c = 0 ; c < centres.size() && !covered ; ++c) {
+			size_t k = (last + c) % centres.size();
+			const double *m = &axes[9*k];
+
+			double x = m[0] * p[0] + m[1] * p[1] + m[2] * p[2];
+			if(x <= 0) continue;
+
+			double y = m[3] * p[0] + m[4] * p[1] + m[5] * p[2];
+			double z = m[6] * p[0] + m[7] * p[1] + m[8] * p[2];
+			if(tx * x - std::abs(y) >= sinMargin * nx && ty * x - std::abs(z) >= sinMargin * ny) {
+				covered = true;
+				last = k;
+			}
+		}
+
+		if(!covered) return false;
+	}
+
+	return true;
+}
+
+
+void TilePlanner::spiral(double aperture, int tileWidth, int tileHeight, double overlap, std::vector<Centre> &centres) {
+	if(aperture <= 0 || aperture >= 180 || tileWidth <= 0 || tileHeight <= 0 || overlap < 0 || overlap >= 1) {
+		throw std::logic_error(std::string("TilePlanner::spiral(): invalid parameters."));
+	}
+
+	Key key(std::make_pair(aperture, overlap), std::make_pair(tileWidth, tileHeight));
+	{
+		boost::mutex::scoped_lock lock(s_Mutex);
+		std::map< Key, std::vector<Centre> >::const_iterator it = s_Plans.find(key);
+		if(it != s_Plans.end()) {
+			centres = it->second;
+			return;
+		}
+	}
+
+	// half tangents of the central part of a frame
+	double tx = (1.0 - overlap) * std::tan(aperture * M_PI / 360.0);
+	double ty = tx * tileHeight / tileWidth;
+
+	// dense and uniform set of directions on which the coverage is checked
+	std::vector<double> probes;
+	const int nbProbes = 20000;
+	for(int i = 0 ; i < nbProbes ; ++i) {
+		double z = 1.0 - 2.0 * i / (nbProbes - 1);
+		double r = std::sqrt(std::max(0.0, 1.0 - z*z));
+		double lon = i * M_PI * (3.0 - std::sqrt(5.0));
+		probes.push_back(r * std::cos(lon));
+		probes.push_back(r * std::sin(lon));
+		probes.push_back(z);
+	}
+
+	// a direction is at most about the spacing of the probes away from the closest probe: the probes are
+	// covered with this margin, so that no direction is left between the frames
+	const double margin = std::sqrt(4.0 * M_PI / nbProbes);
+
+	// no less frames than the sphere over the solid angle of the central part of a frame
+	double solidAngle = 4.0 * std::asin(std::sin(std::atan(tx)) * std::sin(std::atan(ty)));
+	int lowerBound = std::max(2, static_cast<int>(std::ceil(4.0 * M_PI / solidAngle)));
+
+	bool found = false;
+	for(int n = lowerBound ; n <= 16 * lowerBound && !found ; ++n) {
+		spiralCentres(n, centres);
+		found = covers(centres, probes, tx, ty, margin);
+	}
+
+	if(!found) {
+		throw std::logic_error(std::string("TilePlanner::spiral(): the sphere cannot be covered with these parameters."));
+	}
+
+	std::cerr << "[I] Spiral tiling: " << centres.size() << " frames" << std::endl;
+
+	boost::mutex::scoped_lock lock(s_Mutex);
+	s_Plans[key] = centres;
+}
+
+
+
+// ----------------------------------------------------------------------------------------------------------
+// cube map
+
+
+void TilePlanner::cube(double guardBand, std::vector<Centre> &centres, double &aperture, double &feather) {
+	if(guardBand < 0 || guardBand >= 1) {
+		throw std::logic_error(std::string("TilePlanner::cube(): the guard band must be in [0, 1)."));
+	}
+
+	centres.clear();
+	for(int azim = 0 ; azim < 360 ; azim += 90) {
+		centres.push_back(Centre(azim, 0));
+	}
+	centres.push_back(Centre(0,  90));
+	centres.push_back(Centre(0, -90));
+
+	// the half face is 1 in the tangent plane: the guard band on both sides of a seam is blended
+	aperture = 2.0 * std::atan(1.0 + guardBand) * 180.0 / M_PI;
+	feather  = 2.0 * guardBand;
+}
+
+
+
+void TilePlanner::plan(const Projection &projection, std::vector<Centre> &centres, double &aperture, double &feather) {
+	aperture = projection.nrApper;
+	feather  = 0;
+
+	if(Option::tiling == 3) {
+		if(projection.nrrWidth != projection.nrrHeight) {
+			throw std::logic_error(std::string("TilePlanner::plan(): the faces of the cube map need square rectilinear frames."));
+		}
+		cube(Option::cubeGuardBand, centres, aperture, feather);
+	} else if(Option::tiling == 2) {
+		spiral(projection.nrApper, projection.nrrWidth, projection.nrrHeight, Option::tileOverlap, centres);
+	} else {
+		grid(projection.nrApper, centres);
+	}
+}
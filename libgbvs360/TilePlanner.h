@@ -0,0 +1,78 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#ifndef _TilePlanner_
+#define _TilePlanner_
+
+#include <map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+
+// Centres (azimuth, elevation in degrees, as used by Projection) of the rectilinear frames covering the 
+// sphere.
+//
+// grid() is the regular azimuth x elevation grid: a step of half the aperture in azimuth and of the 
+// aperture in elevation, whatever the elevation. Near the poles the frames overlap heavily.
+//
+// spiral() places the centres on a Fibonacci spiral (see evaluation/SpiralSampleSphere.m), which is 
+// uniform on the sphere, and keeps the smallest number of frames for which every direction falls in 
+// the central part of a frame: the frame shrunk by the overlap ratio in its tangent plane. The coverage
+// is checked on a dense set of directions, each with an angular margin larger than the gaps of the set,
+// so that even without overlap no direction is left between the frames. Plans are computed once per 
+// set of parameters.
+//
+// cube() gives the 6 faces of a cube map. Each face is a square frame of 90 degrees widened by the 
+// guard band (ratio of the half face) on each side, so that the features at the edges of a face are 
+// computed with their context. The feather is the band, in the tangent plane, over which the faces are 
+// blended when they are back-projected.
+//
+// plan() is the tiling selected by Option::tiling for the rectilinear frames of projection, with the 
+// aperture and the feather of its frames.
+
+class Projection;
+
+class TilePlanner {
+
+public:
+	typedef std::pair<int, int> 	Centre;			// azimuth, elevation
+
+	static void 	grid 		(double aperture, std::vector<Centre> &centres);
+	static void 	spiral 		(double aperture, int tileWidth, int tileHeight, double overlap, std::vector<Centre> &centres);
+	static void 	cube 		(double guardBand, std::vector<Centre> &centres, double &aperture, double &feather);
+
+	static void 	plan 		(const Projection &projection, std::vector<Centre> &centres, double &aperture, double &feather);
+
+
+private:
+	typedef std::pair< std::pair<double, double>, std::pair<int, int> > 	Key;		// aperture, overlap, tile size
+
+	static boost::mutex 							s_Mutex;
+	static std::map< Key, std::vector<Centre> > 	s_Plans;
+};
+
+
+#endif
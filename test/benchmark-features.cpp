@@ -0,0 +1,224 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <GBVS360.h>
+#include <Projection.h>
+#include <Options.h>
+#include <ThreadPool.h>
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------
+// time the feature extraction of GBVS360 with the current front-end (see Option::featureFrontEnd)
+
+double timeFeatures(GBVS360 &gbvs, const cv::Mat &image, int runs) {
+	double total = 0;
+
+	for(int r = 0 ; r < runs ; ++r) {
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+		gbvs.computeFeatures(image);
+		boost::posix_time::ptime stop = boost::posix_time::microsec_clock::local_time();
+
+		total += (stop - start).total_microseconds() / 1000.0;
+	}
+
+	return total / runs;
+}
+
+
+// correlation of two maps of the same size
+double correlation(const cv::Mat &a, const cv::Mat &b) {
+	cv::Scalar ma, sa, mb, sb;
+	cv::meanStdDev(a, ma, sa);
+	cv::meanStdDev(b, mb, sb);
+	if(sa[0] == 0 || sb[0] == 0)
+		return 0;
+
+	return cv::mean((a - ma[0]).mul(b - mb[0]))[0] / (sa[0] * sb[0]);
+}
+
+
+typedef std::map< std::pair<int, std::pair<int, int> >, cv::Mat > 	MapsByKey;		// channel, level, type
+
+void collectMaps(const GBVS360 &gbvs, MapsByKey &maps) {
+	maps.clear();
+	for(std::list<Feature>::const_iterator it = gbvs.features.begin() ; it != gbvs.features.end() ; ++it) {
+		for(std::list<FeatureMap>::const_iterator mapIt = it->maps.begin() ; mapIt != it->maps.end() ; ++mapIt) {
+			maps[std::make_pair(mapIt->channel, std::make_pair(mapIt->level, mapIt->type))] = mapIt->map.clone();
+		}
+	}
+}
+
+
+
+int main(int argc, char **argv) {
+
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+	// parse parameters
+
+	namespace po = boost::program_options;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+			("help", "produce help message")
+			("input-file,i", po::value< std::vector<std::string> >(), "Input equirectangular images. [default]: imgs/equirectangular.jpg")
+			("runs,r", po::value< int >(), "Number of timed runs per front-end. [default]: 3")
+			("threads,t", po::value< int >(), "Number of threads. [default]: 4")
+			("channels,c", po::value< std::string >(), "Feature channels of GBVS360. [default]: DIO")
+			("tiling", po::value< int >(), "Tiling of the projected frames (see Salient360 --help). [default]: 1")
+			("aperture", po::value< double >(), "Aperture of the projected frames, in degrees. [default]: 70")
+			("rect-width", po::value< int >(), "Width of the projected frames. [default]: 960")
+			("rect-height", po::value< int >(), "Height of the projected frames. [default]: 960")
+	;
+
+
+	po::variables_map vm;
+	try {
+		po::positional_options_description p;
+		p.add("input-file", -1);
+
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+		po::notify(vm);
+	} catch(boost::exception &) {
+		std::cerr << "Error incorect program options. See --help... \n";
+		return 0;
+	}
+
+	if (vm.count("help")) {
+		std::cout << "--------------------------------------------------------------------------------\n";
+		std::cout << "\t\tBenchmark of the feature front-ends of GBVS360\n";
+		std::cout << "--------------------------------------------------------------------------------\n";
+		std::cout << "\n\n";
+		std::cout << desc << "\n";
+		return 1;
+	}
+
+	std::vector<std::string> inputPaths;
+	int runs = 3;
+	std::string channels = "DIO";
+
+	if(vm.count("input-file")) {
+		inputPaths = vm["input-file"].as< std::vector<std::string> >();
+	} else {
+		inputPaths.push_back("imgs/equirectangular.jpg");
+	}
+
+	if(vm.count("runs")) 		runs = std::max(1, vm["runs"].as< int >());
+	if(vm.count("channels")) 	channels = vm["channels"].as< std::string >();
+	if(vm.count("tiling")) 		Option::tiling = vm["tiling"].as< int >();
+
+	Option::threads = vm.count("threads") ? std::max(1, vm["threads"].as< int >()) : 4;
+	ThreadPool::global().resize(static_cast<int>(Option::threads) - 1);
+
+	// same projected frames as Saliency360
+	boost::shared_ptr<Projection> projection(new Projection());
+	projection->nrThread 	= static_cast<int>(Option::threads);
+	projection->nrApper 	= vm.count("aperture") ? vm["aperture"].as< double >() : 70;
+	projection->nrrWidth 	= vm.count("rect-width") ? vm["rect-width"].as< int >() : 960;
+	projection->nrrHeight 	= vm.count("rect-height") ? vm["rect-height"].as< int >() : 960;
+
+	if(projection->nrApper <= 0 || projection->nrrWidth < 128 || projection->nrrHeight < 128) {
+		std::cerr << "[E] the projected frames need an aperture > 0 and at least 128x128 pixels.\n";
+		return 1;
+	}
+
+
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+	// the projected frames are the reference. The maps of the equirectangular front-end are compared to them 
+	// by their correlation, averaged by channel.
+
+	for(size_t i = 0 ; i < inputPaths.size() ; ++i) {
+
+		cv::Mat image = cv::imread(inputPaths[i]);
+		if(image.empty()) {
+			std::cerr << "[E] cannot read: " << inputPaths[i] << "\n";
+			continue;
+		}
+
+		std::cout << "[I] " << inputPaths[i] << std::endl;
+
+		MapsByKey reference;
+		double referenceMs = 0;
+
+		for(int frontEnd = 1 ; frontEnd <= 2 ; ++frontEnd) {
+			Option::featureFrontEnd = frontEnd;
+
+			GBVS360 gbvs(projection);
+			gbvs.channels = channels;
+
+			// warm up: builds the graph, the remap tables and the filters
+			gbvs.computeFeatures(image);
+
+			double ms = timeFeatures(gbvs, image, runs);
+
+			MapsByKey maps;
+			collectMaps(gbvs, maps);
+
+			std::cout << "[I] \t" << (frontEnd == 1 ? "projected frames" : "equirectangular ") << "\t" << ms << " ms/image";
+
+			if(frontEnd == 1) {
+				if(maps.empty()) {
+					std::cerr << "[E] the projected frames gave no feature map, nothing to compare to." << std::endl;
+					break;
+				}
+
+				reference.swap(maps);
+				referenceMs = ms;
+				std::cout << std::endl;
+				continue;
+			}
+
+			std::cout << "\tspeed-up: " << referenceMs / ms << std::endl;
+
+			std::map<int, std::pair<double, int> > byChannel;
+			for(MapsByKey::const_iterator it = maps.begin() ; it != maps.end() ; ++it) {
+				MapsByKey::const_iterator ref = reference.find(it->first);
+				if(ref == reference.end() || ref->second.empty() || ref->second.size() != it->second.size())
+					continue;
+
+				byChannel[it->first.first].first += correlation(it->second, ref->second);
+				byChannel[it->first.first].second += 1;
+			}
+
+			for(std::map<int, std::pair<double, int> >::const_iterator it = byChannel.begin() ; it != byChannel.end() ; ++it) {
+				std::cout << "[I] \t\tchannel " << gbvs.channels[it->first] << ": " << it->second.second << " maps, mean correlation with the projected frames: " 
+						  << it->second.first / it->second.second << std::endl;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,192 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#include <iostream>
+#include <vector>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <GBVS.h>
+#include <FrameCache.h>
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------
+// time the GBVS activation of an image: the feature maps are extracted once per run, and only the activation is timed
+
+double timeActivation(GBVS &gbvs, const cv::Mat &image, int runs, cv::Mat &out) {
+	double total = 0;
+
+	for(int r = 0 ; r < runs ; ++r) {
+		gbvs.computeFeatures(image);
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+		gbvs.gbvsActivation(image, out, true);
+		boost::posix_time::ptime stop = boost::posix_time::microsec_clock::local_time();
+
+		total += (stop - start).total_microseconds() / 1000.0;
+	}
+
+	return total / runs;
+}
+
+
+
+int main(int argc, char **argv) {
+
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+	// parse parameters
+
+	namespace po = boost::program_options;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+			("help", "produce help message")
+			("input-file,i", po::value< std::vector<std::string> >(), "Input images. [default]: the sample images of imgs/")
+			("runs,r", po::value< int >(), "Number of timed runs per configuration. [default]: 5")
+			("batch,b", po::value< int >(), "Number of feature maps solved together by an activation job. [default]: 4")
+			("threads,t", po::value< int >(), "Number of threads of the activation. [default]: 4")
+			("sparse-graph", po::value< double >(), "Use the sparse graph with the given weight cutoff.")
+			("graph-cache", po::value< std::string >(), "Directory where the graphs of the activation are stored.")
+	;
+
+
+	po::variables_map vm;
+	try {
+		po::positional_options_description p;
+		p.add("input-file", -1);
+
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+		po::notify(vm);
+	} catch(boost::exception &) {
+		std::cerr << "Error incorect program options. See --help... \n";
+		return 0;
+	}
+
+	if (vm.count("help")) {
+		std::cout << "--------------------------------------------------------------------------------\n";
+		std::cout << "\t\tBenchmark of the GBVS activation\n";
+		std::cout << "--------------------------------------------------------------------------------\n";
+		std::cout << "\n\n";
+		std::cout << desc << "\n";
+		return 1;
+	}
+
+	std::vector<std::string> inputPaths;
+	int runs = 5;
+	int batch = 4;
+	int threads = 4;
+
+	if(vm.count("input-file")) {
+		inputPaths = vm["input-file"].as< std::vector<std::string> >();
+	} else {
+		inputPaths.push_back("imgs/rectilinear.jpg");
+		inputPaths.push_back("imgs/rectilinear_bw.jpg");
+		inputPaths.push_back("imgs/equirectangular.jpg");
+	}
+
+	if(vm.count("runs")) 		runs = std::max(1, vm["runs"].as< int >());
+	if(vm.count("batch")) 		batch = std::max(1, vm["batch"].as< int >());
+	if(vm.count("threads")) 	threads = std::max(1, vm["threads"].as< int >());
+
+	if(vm.count("graph-cache")) {
+		FrameCache::setDirectory(vm["graph-cache"].as< std::string >());
+	}
+
+
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+	// configurations: the legacy markov matrix, one map per job, and maps solved by batches, in double and
+	// single precision. The deviation is measured against the double precision markov matrix.
+
+	struct Configuration {
+		const char *name;
+		int 		engine;
+		int 		batch;
+		bool 		single;
+	};
+
+	std::vector<Configuration> configurations;
+	Configuration legacy  		= {"markov matrix", 			1, 1, 	  false};
+	Configuration perMap  		= {"matrix-free, 1 map/job", 	2, 1, 	  false};
+	Configuration batched 		= {"matrix-free, batched", 		2, batch, false};
+	Configuration perMapFloat  	= {"matrix-free, 1 map/job, float", 2, 1, true};
+	Configuration batchedFloat 	= {"matrix-free, batched, float", 	2, batch, true};
+	configurations.push_back(legacy);
+	configurations.push_back(perMap);
+	configurations.push_back(batched);
+	configurations.push_back(perMapFloat);
+	configurations.push_back(batchedFloat);
+
+	for(size_t i = 0 ; i < inputPaths.size() ; ++i) {
+
+		cv::Mat image = cv::imread(inputPaths[i]);
+		if(image.empty()) {
+			std::cerr << "[E] cannot read: " << inputPaths[i] << "\n";
+			continue;
+		}
+
+		std::cout << "[I] " << inputPaths[i] << std::endl;
+
+		cv::Mat reference;
+
+		for(size_t c = 0 ; c < configurations.size() ; ++c) {
+			GBVS gbvs;
+			gbvs.nbThreads = threads;
+			gbvs.graphEngine = configurations[c].engine;
+			gbvs.activationBatch = configurations[c].batch;
+			gbvs.singlePrecision = configurations[c].single;
+
+			if(vm.count("sparse-graph")) {
+				gbvs.sparseGraph = true;
+				gbvs.sparseCutoff = vm["sparse-graph"].as< double >();
+			}
+
+			// warm up: builds the graph and the edge weights
+			cv::Mat out;
+			gbvs.compute(image, out);
+
+			double ms = timeActivation(gbvs, image, runs, out);
+
+			double deviation = 0;
+			if(reference.empty()) {
+				reference = out.clone();
+			} else {
+				cv::Mat diff;
+				cv::absdiff(out, reference, diff);
+				cv::minMaxLoc(diff, NULL, &deviation);
+			}
+
+			std::cout << "[I] \t" << configurations[c].name << " (batch: " << configurations[c].batch << ")"
+					  << "\t" << ms << " ms/image"
+					  << "\tmax deviation: " << deviation << std::endl;
+		}
+	}
+
+	return 0;
+}
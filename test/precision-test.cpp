@@ -0,0 +1,243 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+// 
+// Copyright (c) 2017 Pierre Lebreton
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and 
+// associated documentation files (the "Software"), to deal in the Software without restriction, including 
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell 
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the 
+// following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all copies or substantial 
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT 
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <boost/program_options.hpp>
+
+#include <GBVS.h>
+#include <MarkovChain.h>
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------
+// Checks the single precision Markov chains against the double precision ones, on a graph built like the
+// GBVS graph of a rows x cols map (Gaussian weights of the squared distances). The apply() products and the
+// principal eigenvectors are compared, for the dense and the sparse graphs, and the batched chains against
+// the chains solved one by one. The program fails when a relative deviation exceeds the tolerance.
+
+
+struct Graph {
+	int 				size;
+	std::vector<double> dense;
+	std::vector<float> 	densef;
+	SparseGraph 		sparse;
+	std::vector<double> sparseWeights;
+	std::vector<float> 	sparseWeightsf;
+};
+
+
+void buildGraph(int rows, int cols, double cutoff, Graph &graph) {
+	const int N = rows * cols;
+	const double sig = 0.15 * (rows + cols) / 2;
+
+	graph.size = N;
+	graph.dense.resize(static_cast<size_t>(N) * N);
+	std::vector<int> rowPtr(1, 0);
+	std::vector<int> colIdx;
+	std::vector<double> distances;
+
+	for(int a = 0 ; a < N ; ++a) {
+		for(int b = 0 ; b < N ; ++b) {
+			int di = a / rows - b / rows;
+			int dj = a % rows - b % rows;
+			double w = std::exp(-(di*di + dj*dj) / (2*sig*sig));
+
+			graph.dense[static_cast<size_t>(a) * N + b] = w;
+			if(w > cutoff) {
+				colIdx.push_back(b);
+				distances.push_back(di*di + dj*dj);
+				graph.sparseWeights.push_back(w);
+			}
+		}
+		rowPtr.push_back(static_cast<int>(colIdx.size()));
+	}
+
+	graph.sparse.assign(rowPtr, colIdx, distances);
+
+	graph.densef.assign(graph.dense.begin(), graph.dense.end());
+	graph.sparseWeightsf.assign(graph.sparseWeights.begin(), graph.sparseWeights.end());
+}
+
+
+double maxAbs(const std::vector<double> &v) {
+	double m = 0;
+	for(size_t i = 0 ; i < v.size() ; ++i)
+		m = std::max(m, std::abs(v[i]));
+	return m;
+}
+
+
+// max |a-b| relative to max |a|
+template<typename T>
+double deviation(const std::vector<double> &a, const std::vector<T> &b) {
+	double d = 0;
+	for(size_t i = 0 ; i < a.size() ; ++i)
+		d = std::max(d, std::abs(a[i] - b[i]));
+	return d / std::max(maxAbs(a), 1e-300);
+}
+
+
+bool check(const std::string &name, double dev, double tolerance) {
+	bool ok = dev <= tolerance;
+	std::cout << (ok ? "[I] \t" : "[E] \t") << name << "\tmax relative deviation: " << dev << std::endl;
+	return ok;
+}
+
+
+
+int main(int argc, char **argv) {
+
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+	// parse parameters
+
+	namespace po = boost::program_options;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+			("help", "produce help message")
+			("rows", po::value< int >(), "Number of rows of the map of the graph. [default]: 30")
+			("cols", po::value< int >(), "Number of columns of the map of the graph. [default]: 40")
+			("tolerance", po::value< double >(), "Maximum relative deviation from the double precision chains. [default]: 1e-5")
+	;
+
+
+	po::variables_map vm;
+	try {
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		po::notify(vm);
+	} catch(boost::exception &) {
+		std::cerr << "Error incorect program options. See --help... \n";
+		return 1;
+	}
+
+	if (vm.count("help")) {
+		std::cout << "--------------------------------------------------------------------------------\n";
+		std::cout << "\t\tSingle precision Markov chains against the double precision ones\n";
+		std::cout << "--------------------------------------------------------------------------------\n";
+		std::cout << "\n\n";
+		std::cout << desc << "\n";
+		return 1;
+	}
+
+	int rows = 30;
+	int cols = 40;
+	double tolerance = 1e-5;
+
+	if(vm.count("rows")) 		rows = std::max(2, vm["rows"].as< int >());
+	if(vm.count("cols")) 		cols = std::max(2, vm["cols"].as< int >());
+	if(vm.count("tolerance")) 	tolerance = vm["tolerance"].as< double >();
+
+
+	Graph graph;
+	buildGraph(rows, cols, 1e-3, graph);
+	const int N = graph.size;
+
+	std::srand(1);
+	std::vector<double> AL(N), v(N);
+	for(int i = 0 ; i < N ; ++i) {
+		AL[i] = std::rand() / static_cast<double>(RAND_MAX);
+		v[i]  = std::rand() / static_cast<double>(RAND_MAX);
+	}
+	std::vector<float> ALf(AL.begin(), AL.end());
+	std::vector<float> vf(v.begin(), v.end());
+
+	bool ok = true;
+
+	for(int algtype = 1 ; algtype <= 3 ; ++algtype) {
+		std::cout << "[I] algtype: " << algtype << std::endl;
+
+		MarkovChain<double> dense(&graph.dense[0], N, AL, algtype);
+		MarkovChain<float>  densef(&graph.densef[0], N, ALf, algtype);
+		MarkovChain<double> sparse(graph.sparse, &graph.sparseWeights[0], AL, algtype);
+		MarkovChain<float>  sparsef(graph.sparse, &graph.sparseWeightsf[0], ALf, algtype);
+
+
+		// one product
+		std::vector<double> out(N);
+		std::vector<float> outf(N);
+
+		dense.apply(&v[0], &out[0]);
+		densef.apply(&vf[0], &outf[0]);
+		ok &= check("dense, M * v", deviation(out, outf), tolerance);
+
+		sparse.apply(&v[0], &out[0]);
+		sparsef.apply(&vf[0], &outf[0]);
+		ok &= check("sparse, M * v", deviation(out, outf), tolerance);
+
+
+		// principal eigenvectors
+		int iteri;
+		std::vector<double> eig = AL;
+		std::vector<float> eigf = ALf;
+
+		principalEigenvector(dense, 1e-9, eig, iteri);
+		principalEigenvector(densef, 1e-9, eigf, iteri);
+		ok &= check("dense, eigenvector", deviation(eig, eigf), tolerance);
+
+		eig = AL;
+		eigf = ALf;
+		principalEigenvector(sparse, 1e-9, eig, iteri);
+		principalEigenvector(sparsef, 1e-9, eigf, iteri);
+		ok &= check("sparse, eigenvector", deviation(eig, eigf), tolerance);
+
+
+		// batched chains: the first one is AL, the second one its mirror, against the double chains solved one by one
+		std::vector<float> batch0 = ALf, batch1 = ALf;
+		std::vector<double> mirror = AL;
+		for(int i = 0 ; i < N ; ++i) {
+			mirror[i] = 1.01 - AL[i];
+			batch1[i] = static_cast<float>(mirror[i]);
+		}
+
+		std::vector< std::vector<float>* > batch;
+		batch.push_back(&batch0);
+		batch.push_back(&batch1);
+
+		std::vector<int> iterations;
+		BatchedMarkovChain<float> batched(&graph.densef[0], N, batch, algtype);
+		principalEigenvectors(batched, 1e-9, batch, iterations);
+
+		eig = AL;
+		principalEigenvector(dense, 1e-9, eig, iteri);
+		ok &= check("batched, eigenvector 1", deviation(eig, batch0), tolerance);
+
+		MarkovChain<double> denseMirror(&graph.dense[0], N, mirror, algtype);
+		eig = mirror;
+		principalEigenvector(denseMirror, 1e-9, eig, iteri);
+		ok &= check("batched, eigenvector 2", deviation(eig, batch1), tolerance);
+	}
+
+	if(!ok) {
+		std::cerr << "[E] the single precision chains deviate from the double precision ones." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[I] passed." << std::endl;
+	return 0;
+}
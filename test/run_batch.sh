@@ -3,6 +3,7 @@
 PathToBin=../bin
 PathToImages=/Volumes/SSD/Salient360/trainSet/Stimuli/
 PathToOutput=/Volumes/SSD/Salient360/trainSet/$2
+PathToGraphCache=$PathToOutput/graph-cache
 
 
 mkdir -p $PathToOutput/Action
@@ -25,11 +26,12 @@ mkdir -p $PathToOutput/Random
 mkdir -p $PathToOutput/Satelite
 mkdir -p $PathToOutput/Sketch
 mkdir -p $PathToOutput/Social
+mkdir -p $PathToGraphCache
 
 
 while read fileName
 do
 	echo $fileName
-	$PathToBin/test-saliency -i $PathToImages/$fileName -o $PathToOutput/$fileName
+	$PathToBin/salient -i $PathToImages/$fileName -o $PathToOutput/$fileName --graph-cache $PathToGraphCache
 done < $1
 